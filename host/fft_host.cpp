@@ -0,0 +1,465 @@
+/**
+ * @file fft_host.cpp
+ * @brief Zynq PS host runtime for the fft IP (see fft_host.h)
+ */
+
+#include "fft_host.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FFT_HOST_NEON 1
+#else
+#define FFT_HOST_NEON 0
+#endif
+
+/* ---------- Register Map ---------- */
+// fft s_axilite offsets from the driver Vitis exports with the IP
+// (solution1/impl/misc/drivers/fft_v1_0/src); the fallbacks are those of a
+// build with only hop and peak_thresh after num_frames. The registers and
+// RAMs of the other options are placed by Vitis, so those builds need the
+// driver header.
+#if defined(__has_include)
+#if __has_include("xfft_hw.h")
+#include "xfft_hw.h"
+#endif
+#endif
+#ifndef XFFT_CONTROL_ADDR_AP_CTRL
+#if FFT_AVG || FFT_PERF || FFT_FASTCONV || FFT_PFB_TAPS || FFT_WINDOW == FFT_WINDOW_RAM
+#error "FFT_AVG, FFT_PERF, FFT_FASTCONV, FFT_PFB_TAPS and FFT_WINDOW_RAM need xfft_hw.h on the include path"
+#endif
+#define XFFT_CONTROL_ADDR_AP_CTRL         0x00
+#define XFFT_CONTROL_ADDR_FFT_LEN_DATA    0x10
+#define XFFT_CONTROL_ADDR_CTRL_DATA       0x18
+#define XFFT_CONTROL_ADDR_NUM_FRAMES_DATA 0x20
+#define XFFT_CONTROL_ADDR_HOP_DATA        0x28   // FFT_STFT
+#define XFFT_CONTROL_ADDR_PEAK_THRESH_DATA (0x28 + 8 * FFT_STFT)   // FFT_PEAKS
+#endif
+#define FFT_AP_START 0x1
+#define FFT_AP_IDLE  0x4
+#define FFT_REG_SPAN 0x10000   // AXI-Lite window of the IP, RAMs included
+
+#if FFT_PERF
+static_assert(XFFT_CONTROL_ADDR_PERF_HIGH < FFT_REG_SPAN, "perf outside FFT_REG_SPAN");
+#endif
+#if FFT_FASTCONV
+static_assert(XFFT_CONTROL_ADDR_FILTER_COEF_HIGH < FFT_REG_SPAN, "filter_coef outside FFT_REG_SPAN");
+#endif
+#if FFT_PFB_TAPS
+static_assert(XFFT_CONTROL_ADDR_PFB_COEF_HIGH < FFT_REG_SPAN, "pfb_coef outside FFT_REG_SPAN");
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+static_assert(XFFT_CONTROL_ADDR_WINDOW_COEF_HIGH < FFT_REG_SPAN, "window_coef outside FFT_REG_SPAN");
+#endif
+
+// AXI DMA simple mode registers (PG021)
+#define DMA_MM2S_DMACR  0x00
+#define DMA_MM2S_DMASR  0x04
+#define DMA_MM2S_SA     0x18
+#define DMA_MM2S_SA_MSB 0x1C
+#define DMA_MM2S_LENGTH 0x28
+#define DMA_S2MM_DMACR  0x30
+#define DMA_S2MM_DMASR  0x34
+#define DMA_S2MM_DA     0x48
+#define DMA_S2MM_DA_MSB 0x4C
+#define DMA_S2MM_LENGTH 0x58
+#define DMA_CR_RUN      0x1
+#define DMA_CR_RESET    0x4
+#define DMA_CR_IOC_IRQ  0x1000
+#define DMA_CR_ERR_IRQ  0x4000
+#define DMA_SR_HALTED   0x1
+#define DMA_SR_IDLE     0x2
+#define DMA_SR_ERRORS   0x470   // internal, slave and decode errors, Err_Irq
+#define DMA_SR_IOC_IRQ  0x1000
+#define DMA_REG_SPAN    0x10000
+
+/* ================================================================
+ *  Bulk Conversion
+ * ================================================================ */
+
+#if FFT_HOST_NEON
+/**
+ * @brief Four floats to fixed_t bit patterns
+ *
+ * vcvtq_s32_f32 rounds toward zero; fixed_t truncates toward minus
+ * infinity, so negative non-integer products step down by one.
+ */
+static inline int32x4_t q16_from_float(float32x4_t x) {
+    float32x4_t s  = vmulq_n_f32(x, 65536.0f);
+    int32x4_t   t  = vcvtq_s32_f32(s);
+    uint32x4_t  lt = vcltq_f32(s, vcvtq_f32_s32(t));
+    return vaddq_s32(t, vreinterpretq_s32_u32(lt));   // lt lanes are -1
+}
+#endif
+
+void fft_pack(const float *re, const float *im, size_t n, uint64_t *words) {
+    size_t i = 0;
+#if FFT_HOST_NEON
+    // Little-endian word: imaginary in the lower, real in the upper 32 bits
+    int32_t *out = reinterpret_cast<int32_t *>(words);
+    for (; i + 4 <= n; i += 4) {
+        int32x4x2_t v;
+        v.val[0] = q16_from_float(vld1q_f32(im + i));
+        v.val[1] = q16_from_float(vld1q_f32(re + i));
+        vst2q_s32(out + 2 * i, v);
+    }
+#endif
+    for (; i < n; i++)
+        words[i] = pack_data((fixed_t)re[i], (fixed_t)im[i]).to_uint64();
+}
+
+void fft_unpack(const uint64_t *words, size_t n, float *re, float *im) {
+    size_t i = 0;
+#if FFT_HOST_NEON
+    const int32_t *in = reinterpret_cast<const int32_t *>(words);
+    for (; i + 4 <= n; i += 4) {
+        int32x4x2_t v = vld2q_s32(in + 2 * i);
+        vst1q_f32(im + i, vcvtq_n_f32_s32(v.val[0], 16));
+        vst1q_f32(re + i, vcvtq_n_f32_s32(v.val[1], 16));
+    }
+#endif
+    for (; i < n; i++) {
+        fixed_t r, q;
+        unpack_data((data_t)words[i], r, q);
+        re[i] = r.to_float();
+        im[i] = q.to_float();
+    }
+}
+
+void fft_unpack_scalars(const uint64_t *words, size_t n, float *bins) {
+    size_t i = 0;
+#if FFT_HOST_NEON
+    const float *in = reinterpret_cast<const float *>(words);
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t v = vld2q_f32(in + 2 * i);
+        float32x4x2_t s;
+        s.val[0] = v.val[1];
+        s.val[1] = v.val[0];
+        vst2q_f32(bins + 2 * i, s);
+    }
+#endif
+    for (; i < n; i++) {
+        beat_t beat = (data_t)words[i];
+        unpack_scalars(beat, 0, bins[2 * i], bins[2 * i + 1]);
+    }
+}
+
+void fft_unpack_peaks(const uint64_t *words, size_t n, float *power, uint32_t *bins) {
+    for (size_t i = 0; i < n; i++) {
+        ap_uint<32> bin;
+        unpack_peak((data_t)words[i], power[i], bin);
+        bins[i] = bin.to_uint();
+    }
+}
+
+/* ================================================================
+ *  Device Access
+ * ================================================================ */
+
+/**
+ * @brief Read one number from a u-dma-buf sysfs attribute
+ * @param fmt "%llx" for phys_addr, "%llu" for size
+ */
+static int udmabuf_attr(const char *name, const char *attr, const char *fmt, uint64_t &value) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/%s", name, attr);
+    FILE *f = fopen(path, "r");
+    if (!f) return -errno;
+    unsigned long long v = 0;
+    int ok = fscanf(f, fmt, &v);
+    fclose(f);
+    if (ok != 1) return -EINVAL;
+    value = v;
+    return 0;
+}
+
+/**
+ * @brief Write "1" to a u-dma-buf sysfs trigger (sync_for_cpu / _device)
+ */
+static int udmabuf_trigger(const char *name, const char *attr) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/u-dma-buf/%s/%s", name, attr);
+    int fd = ::open(path, O_WRONLY);
+    if (fd < 0) return -errno;
+    int ret = (::write(fd, "1", 1) == 1) ? 0 : -errno;
+    ::close(fd);
+    return ret;
+}
+
+int fft_cma_buffer::open(const char *dev_name) {
+    snprintf(name, sizeof(name), "%s", dev_name);
+    uint64_t sz = 0;
+    int ret = udmabuf_attr(name, "phys_addr", "%llx", phys);
+    if (!ret) ret = udmabuf_attr(name, "size", "%llu", sz);
+    if (ret) return ret;
+
+    char dev[80];
+    snprintf(dev, sizeof(dev), "/dev/%s", name);
+    fd = ::open(dev, O_RDWR);
+    if (fd < 0) return -errno;
+    void *p = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ret = -errno;
+        close();
+        return ret;
+    }
+    data = p;
+    size = sz;
+    return 0;
+}
+
+void fft_cma_buffer::close() {
+    if (data) munmap(data, size);
+    if (fd >= 0) ::close(fd);
+    data = nullptr;
+    size = 0;
+    fd   = -1;
+}
+
+int fft_cma_buffer::sync_for_device() { return udmabuf_trigger(name, "sync_for_device"); }
+int fft_cma_buffer::sync_for_cpu()    { return udmabuf_trigger(name, "sync_for_cpu"); }
+
+int fft_mmio::map(uint64_t base, size_t len) {
+    int fd = ::open("/dev/mem", O_RDWR | O_SYNC);
+    if (fd < 0) return -errno;
+    void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)base);
+    int ret = (p == MAP_FAILED) ? -errno : 0;
+    ::close(fd);
+    if (ret) return ret;
+    regs = static_cast<volatile uint32_t *>(p);
+    size = len;
+    return 0;
+}
+
+void fft_mmio::unmap() {
+    if (regs) munmap(const_cast<uint32_t *>(regs), size);
+    regs = nullptr;
+    size = 0;
+}
+
+/* ================================================================
+ *  Double-Buffered Runtime
+ * ================================================================ */
+
+int fft_host::open(const fft_host_config &config) {
+    int ret = fft_regs_.map(config.fft_base, FFT_REG_SPAN);
+    if (!ret) ret = dma_regs_.map(config.dma_base, DMA_REG_SPAN);
+    for (int i = 0; i < 2 && !ret; i++)
+        ret = slots_[i].buf.open(config.cma[i]);
+    if (!ret && config.uio) {
+        uio_fd_ = ::open(config.uio, O_RDWR);
+        if (uio_fd_ < 0) ret = -errno;
+    }
+    if (ret) {
+        close();
+        return ret;
+    }
+    max_transfer_ = config.max_transfer;
+
+    // One reset bit resets both channels; then run them
+    dma_regs_.write(DMA_MM2S_DMACR, DMA_CR_RESET);
+    while (dma_regs_.read(DMA_MM2S_DMACR) & DMA_CR_RESET) {}
+    dma_regs_.write(DMA_MM2S_DMACR, DMA_CR_RUN);
+    // With a UIO an error interrupts too, so wait_running() sees it
+    dma_regs_.write(DMA_S2MM_DMACR, DMA_CR_RUN | (uio_fd_ >= 0 ? DMA_CR_IOC_IRQ | DMA_CR_ERR_IRQ : 0));
+    return 0;
+}
+
+void fft_host::close() {
+    // Drain the running batch and the queued one it starts; on an error
+    // the rest are dropped, since the DMA may never finish them
+    while (running_ >= 0) {
+        if (wait_running()) break;
+    }
+    running_ = -1;
+    if (uio_fd_ >= 0) ::close(uio_fd_);
+    uio_fd_ = -1;
+    for (slot &s : slots_) {
+        s.buf.close();
+        s.state = SLOT_FREE;
+    }
+    fft_regs_.unmap();
+    dma_regs_.unmap();
+}
+
+int fft_host::submit(const float *re, const float *im, unsigned frames) {
+    if (frames == 0) frames = 1;
+    slot &s = slots_[next_ticket_ & 1];
+    if (s.state != SLOT_FREE) return -EBUSY;
+
+    s.in_words = (size_t)frames * fft_frame_words(len_, hop_);
+    if (s.in_words * sizeof(uint64_t) > s.buf.size / 2) return -EINVAL;
+    if (s.in_words * sizeof(uint64_t) > max_transfer_) return -EINVAL;
+
+    // Pack while the DMA works on the other buffer
+    fft_pack(re, im, s.in_words, in_words(s));
+    int ret = s.buf.sync_for_device();
+    if (ret) return ret;
+    s.frames = frames;
+    s.ticket = next_ticket_++;
+    s.state  = SLOT_QUEUED;
+    if (running_ < 0) {
+        ret = start(s);
+        if (ret) return ret;
+    }
+    return s.ticket;
+}
+
+/**
+ * @brief Program the IP for slot s and hand its buffer to the DMA
+ *
+ * S2MM is armed first with the whole output half, up to max_transfer, so
+ * the IP never stalls on its output; its transfer ends at the batch TLAST.
+ */
+int fft_host::start(slot &s) {
+    uint64_t in_phys  = s.buf.phys;
+    uint64_t out_phys = s.buf.phys + s.buf.size / 2;
+    size_t   out_max  = s.buf.size / 2 < max_transfer_ ? s.buf.size / 2 : max_transfer_;
+    fft_regs_.write(XFFT_CONTROL_ADDR_FFT_LEN_DATA, len_);
+    fft_regs_.write(XFFT_CONTROL_ADDR_CTRL_DATA, ctrl_ | FFT_CTRL_BATCH_TLAST);
+    fft_regs_.write(XFFT_CONTROL_ADDR_NUM_FRAMES_DATA, s.frames);
+#if FFT_STFT
+    fft_regs_.write(XFFT_CONTROL_ADDR_HOP_DATA, hop_);
+#endif
+#if FFT_AVG
+    fft_regs_.write(XFFT_CONTROL_ADDR_AVG_FRAMES_DATA, avg_frames_);
+#endif
+#if FFT_PEAKS
+    fft_regs_.write(XFFT_CONTROL_ADDR_PEAK_THRESH_DATA, float_bits(peak_thresh_).to_uint());
+#endif
+    fft_regs_.write(XFFT_CONTROL_ADDR_AP_CTRL, FFT_AP_START);
+
+    if (uio_fd_ >= 0) {
+        uint32_t unmask = 1;
+        if (::write(uio_fd_, &unmask, sizeof(unmask)) != sizeof(unmask)) return -errno;
+    }
+    dma_regs_.write(DMA_S2MM_DMASR, DMA_SR_IOC_IRQ);
+    dma_regs_.write(DMA_S2MM_DA, (uint32_t)out_phys);
+    dma_regs_.write(DMA_S2MM_DA_MSB, (uint32_t)(out_phys >> 32));
+    dma_regs_.write(DMA_S2MM_LENGTH, (uint32_t)(out_max & ~(size_t)(sizeof(uint64_t) - 1)));
+    dma_regs_.write(DMA_MM2S_SA, (uint32_t)in_phys);
+    dma_regs_.write(DMA_MM2S_SA_MSB, (uint32_t)(in_phys >> 32));
+    dma_regs_.write(DMA_MM2S_LENGTH, (uint32_t)(s.in_words * sizeof(uint64_t)));
+
+    s.state  = SLOT_RUNNING;
+    running_ = (int)(&s - slots_);
+    return 0;
+}
+
+/**
+ * @brief Wait for the running slot, then start the queued one
+ */
+int fft_host::wait_running() {
+    slot &s = slots_[running_];
+    uint32_t sr;
+    if (uio_fd_ >= 0) {
+        uint32_t count;
+        if (::read(uio_fd_, &count, sizeof(count)) != sizeof(count)) return -errno;
+        sr = dma_regs_.read(DMA_S2MM_DMASR);
+    } else {
+        do {
+            sr = dma_regs_.read(DMA_S2MM_DMASR);
+        } while (!(sr & (DMA_SR_IOC_IRQ | DMA_SR_ERRORS)));
+    }
+    if (sr & DMA_SR_ERRORS) return -EIO;
+    while (!(dma_regs_.read(DMA_MM2S_DMASR) & (DMA_SR_IDLE | DMA_SR_HALTED))) {}
+
+    // S2MM_LENGTH reads back the bytes received up to TLAST
+    s.out_words = dma_regs_.read(DMA_S2MM_LENGTH) / sizeof(uint64_t);
+    s.state  = SLOT_DONE;
+    running_ = -1;
+
+    slot &other = slots_[(&s - slots_) ^ 1];
+    if (other.state == SLOT_QUEUED) return start(other);
+    return 0;
+}
+
+/**
+ * @brief Wait until ticket's slot is done and hand its buffer to the CPU
+ */
+int fft_host::finish(int ticket, slot *&s) {
+    s = &slots_[ticket & 1];
+    if (s->ticket != ticket || s->state == SLOT_FREE) return -EINVAL;
+    while (s->state != SLOT_DONE) {
+        int ret = wait_running();
+        if (ret) return ret;
+    }
+    return s->buf.sync_for_cpu();
+}
+
+int fft_host::complete(int ticket, float *re, float *im) {
+    slot *s;
+    int ret = finish(ticket, s);
+    if (ret) return ret;
+    fft_unpack(out_words(*s), s->out_words, re, im);
+    s->state = SLOT_FREE;
+    return (int)s->out_words;
+}
+
+int fft_host::complete_scalars(int ticket, float *bins) {
+    slot *s;
+    int ret = finish(ticket, s);
+    if (ret) return ret;
+    fft_unpack_scalars(out_words(*s), s->out_words, bins);
+    s->state = SLOT_FREE;
+    return (int)(2 * s->out_words);
+}
+
+#if FFT_PEAKS
+int fft_host::complete_peaks(int ticket, float *power, uint32_t *bins) {
+    slot *s;
+    int ret = finish(ticket, s);
+    if (ret) return ret;
+    fft_unpack_peaks(out_words(*s), s->out_words, power, bins);
+    s->state = SLOT_FREE;
+    return (int)s->out_words;
+}
+#endif
+
+/* ================================================================
+ *  Coefficient RAMs and Counters
+ * ================================================================ */
+
+/**
+ * @brief Write n words to an s_axilite RAM while the IP is idle
+ */
+int fft_host::load_ram(uint32_t base, const uint32_t *words, unsigned n) {
+    if (running_ >= 0) return -EBUSY;
+    for (unsigned i = 0; i < n; i++)
+        fft_regs_.write(base + 4 * i, words[i]);
+    return 0;
+}
+
+#if FFT_PERF
+int fft_host::read_perf(uint32_t counters[FFT_PERF_REGS]) {
+    if (running_ >= 0) return -EBUSY;
+    // The DMA ends at the last output beat; the counters follow it
+    while (!(fft_regs_.read(XFFT_CONTROL_ADDR_AP_CTRL) & FFT_AP_IDLE)) {}
+    for (int i = 0; i < FFT_PERF_REGS; i++)
+        counters[i] = fft_regs_.read(XFFT_CONTROL_ADDR_PERF_BASE + 4 * i);
+    return 0;
+}
+#endif
+
+#if FFT_FASTCONV
+int fft_host::load_filter(const uint32_t *words) {
+    return load_ram(XFFT_CONTROL_ADDR_FILTER_COEF_BASE, words, FFT_SIZE);
+}
+#endif
+
+#if FFT_PFB_TAPS
+int fft_host::load_pfb(const uint32_t *words) {
+    return load_ram(XFFT_CONTROL_ADDR_PFB_COEF_BASE, words, FFT_PFB_TAPS * FFT_SIZE / 2);
+}
+#endif
+
+#if FFT_WINDOW == FFT_WINDOW_RAM
+int fft_host::load_window(const uint32_t *words) {
+    return load_ram(XFFT_CONTROL_ADDR_WINDOW_COEF_BASE, words, FFT_WINDOW_LEN / 2);
+}
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @file fft_host.h
+ * @brief Zynq PS host runtime for the fft IP behind an AXI DMA
+ *
+ * Linux user-space driver for the streaming top (fft.cpp) wired to a Xilinx
+ * AXI DMA in simple (register) mode:
+ *   - Bulk float <-> AXI word conversion with the pack_data layout of fft.h
+ *     (real in [63:32], imaginary in [31:0]), NEON-vectorized on ARM
+ *   - Two u-dma-buf CMA buffers used ping-pong, so the CPU packs the next
+ *     batch and unpacks the previous one while the DMA moves the current one
+ *   - Completion by polling the DMA status or by a UIO interrupt
+ *   - Asynchronous submit / complete API
+ * Compile with the same -D options as the IP so fft.h describes the same
+ * transform size, SSR and output formats.
+ */
+
+#ifndef FFT_HOST_H
+#define FFT_HOST_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fft.h"
+
+/* ================================================================
+ *  Bulk Conversion
+ * ================================================================ */
+
+/**
+ * @brief Pack n complex samples into AXI words (fixed_t, pack_data layout)
+ *
+ * Bit-exact with pack_data((fixed_t)re[i], (fixed_t)im[i]) for inputs in the
+ * fixed_t range [-32768, 32768). One 64-bit word per sample, so with
+ * FFT_SSR > 1 consecutive words fill the lanes of a beat in order.
+ */
+void fft_pack(const float *re, const float *im, size_t n, uint64_t *words);
+
+/**
+ * @brief Unpack n AXI words into complex samples (inverse of fft_pack)
+ */
+void fft_unpack(const uint64_t *words, size_t n, float *re, float *im);
+
+/**
+ * @brief Unpack n scalar-format words (FFT_SCALAR_OUT) into 2n bins in order
+ *
+ * Each word holds two consecutive float bins, the lower bin in the upper
+ * 32 bits (unpack_scalars layout).
+ */
+void fft_unpack_scalars(const uint64_t *words, size_t n, float *bins);
+
+/**
+ * @brief Unpack n peak records (FFT_PEAKS) into |X|^2 and bin index
+ *
+ * Vacant records give bin FFT_PEAK_NONE and power 0.
+ */
+void fft_unpack_peaks(const uint64_t *words, size_t n, float *power, uint32_t *bins);
+
+/* ================================================================
+ *  Frame Sizing
+ * ================================================================ */
+
+/**
+ * @brief Transform length the IP runs for length register value len
+ *
+ * Mirrors decode_log2_len: the register keeps LOG2_FFT_SIZE + 1 bits,
+ * 0 selects FFT_SIZE, other values round down to a power of two from 16
+ * to FFT_SIZE. The SDF engine always runs FFT_SIZE points.
+ */
+inline unsigned fft_frame_len(unsigned len) {
+    len &= (2u << LOG2_FFT_SIZE) - 1;
+    if (FFT_ENGINE == FFT_ENGINE_SDF || len == 0) return FFT_SIZE;
+    unsigned frame = 16;
+    while (frame < FFT_SIZE && 2 * frame <= len) frame *= 2;
+    return frame;
+}
+
+/**
+ * @brief Input words the IP reads per frame for register values len and hop
+ *
+ * Mirrors stft_hop_beats: with FFT_STFT the hop (also LOG2_FFT_SIZE + 1
+ * bits) is rounded down to whole beats, and 0 or a hop longer than the
+ * frame reads the whole frame.
+ */
+inline size_t fft_frame_words(unsigned len, unsigned hop) {
+    const unsigned frame = fft_frame_len(len);
+#if FFT_STFT
+    const unsigned beats = (hop & ((2u << LOG2_FFT_SIZE) - 1)) >> LOG2_FFT_SSR;
+    if (beats != 0 && beats <= frame / FFT_SSR) return (size_t)beats * FFT_SSR;
+#else
+    (void)hop;
+#endif
+    return frame;
+}
+
+/* ================================================================
+ *  Device Access
+ * ================================================================ */
+
+/**
+ * @brief CMA buffer from the u-dma-buf driver (/dev/<name>)
+ *
+ * Mapped cached; sync_for_device() / sync_for_cpu() hand the buffer to the
+ * DMA and back.
+ */
+struct fft_cma_buffer {
+    void    *data = nullptr;
+    uint64_t phys = 0;
+    size_t   size = 0;
+    int      fd   = -1;
+    char     name[64] = {};
+
+    int  open(const char *dev_name);
+    void close();
+    int  sync_for_device();
+    int  sync_for_cpu();
+};
+
+/**
+ * @brief Memory-mapped register window through /dev/mem
+ */
+struct fft_mmio {
+    volatile uint32_t *regs = nullptr;
+    size_t             size = 0;
+
+    int  map(uint64_t base, size_t len);
+    void unmap();
+    uint32_t read(uint32_t offset) const { return regs[offset / 4]; }
+    void     write(uint32_t offset, uint32_t value) { regs[offset / 4] = value; }
+};
+
+// Largest AXI DMA transfer with the default 14-bit buffer length register
+#define FFT_DMA_MAX_TRANSFER 16383
+
+/**
+ * @brief Board addresses of one fft instance
+ */
+struct fft_host_config {
+    uint64_t    fft_base;      // s_axilite "control" base address of the fft IP
+    uint64_t    dma_base;      // AXI DMA register base address
+    const char *cma[2];        // u-dma-buf device names, e.g. "udmabuf0", "udmabuf1"
+    const char *uio = nullptr; // UIO device of the DMA S2MM interrupt, nullptr to poll
+    uint32_t    max_transfer = FFT_DMA_MAX_TRANSFER;   // 2^width - 1 of the DMA length register
+};
+
+/**
+ * @brief Asynchronous, double-buffered fft runtime
+ *
+ * submit() packs a batch of frames into the free CMA buffer and starts it
+ * at once if the engine is idle, otherwise when the batch ahead completes,
+ * so at most two batches are in flight. complete() waits for a batch,
+ * starts the queued one before unpacking, and returns the result words.
+ * Each CMA buffer holds the input in its first half and the output in its
+ * second half, so a batch is limited to half a buffer each way.
+ *
+ * Every batch runs with FFT_CTRL_BATCH_TLAST, since the DMA S2MM channel
+ * ends its transfer at TLAST. The BFP exponent (TUSER) does not pass the
+ * DMA; with FFT_BFP read it through another path. With FFT_ENGINE_SDF a
+ * batch's output is that of the frames FFT_FRAME_LATENCY calls earlier.
+ * All calls return 0 (or a ticket / count) on success and -errno on failure.
+ */
+class fft_host {
+public:
+    fft_host() = default;
+    ~fft_host() { close(); }
+    fft_host(const fft_host &) = delete;
+    fft_host &operator=(const fft_host &) = delete;
+
+    int  open(const fft_host_config &config);
+    void close();
+
+    /** @brief Transform length (fft_len register) for later submissions, rounded as by the IP */
+    void set_length(unsigned len) { len_ = fft_frame_len(len); }
+    /** @brief FFT_CTRL_* bits for later submissions */
+    void set_ctrl(unsigned ctrl) { ctrl_ = ctrl; }
+#if FFT_STFT
+    /** @brief New input samples per frame (hop register), 0 for a full frame */
+    void set_hop(unsigned hop) { hop_ = hop; }
+#endif
+#if FFT_AVG
+    /** @brief Power spectra per averaged output (avg_frames register) */
+    void set_avg_frames(unsigned frames) { avg_frames_ = frames; }
+#endif
+#if FFT_PEAKS
+    /** @brief Least |X|^2 of a reported peak (peak_thresh register) */
+    void set_peak_thresh(float thresh) { peak_thresh_ = thresh; }
+#endif
+
+    /*
+     * The coefficient RAMs and counters are shared with the running call,
+     * so these return -EBUSY while a batch is in flight.
+     */
+#if FFT_PERF
+    /** @brief Counters of the last finished call, FFT_PERF_REGS words in FFT_PERF_* order */
+    int read_perf(uint32_t counters[FFT_PERF_REGS]);
+#endif
+#if FFT_FASTCONV
+    /** @brief Write the filter_coef RAM, FFT_SIZE filter_word_t words */
+    int load_filter(const uint32_t *words);
+#endif
+#if FFT_PFB_TAPS
+    /** @brief Write the pfb_coef RAM, FFT_PFB_TAPS * FFT_SIZE / 2 words; FFT_CTRL_PFB_LOAD applies it */
+    int load_pfb(const uint32_t *words);
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+    /** @brief Write the window_coef RAM, FFT_WINDOW_LEN / 2 window_word_t words */
+    int load_window(const uint32_t *words);
+#endif
+
+    /**
+     * @brief Queue `frames` frames of input samples
+     * @return Ticket for complete(), -EBUSY if both buffers are in flight, or
+     *         -EINVAL if the input exceeds half a buffer or max_transfer
+     */
+    int submit(const float *re, const float *im, unsigned frames);
+
+    /**
+     * @brief Wait for a ticket and unpack its complex output
+     * @return Output samples written to re / im
+     */
+    int complete(int ticket, float *re, float *im);
+
+    /**
+     * @brief Wait for a ticket and unpack its scalar output (FFT_SCALAR_OUT)
+     * @return Output bins written to bins
+     */
+    int complete_scalars(int ticket, float *bins);
+
+#if FFT_PEAKS
+    /**
+     * @brief Wait for a ticket and unpack its peak records (FFT_CTRL_PEAKS)
+     * @return Records written to power / bins, FFT_PEAKS per frame
+     */
+    int complete_peaks(int ticket, float *power, uint32_t *bins);
+#endif
+
+private:
+    enum slot_state { SLOT_FREE, SLOT_QUEUED, SLOT_RUNNING, SLOT_DONE };
+    struct slot {
+        fft_cma_buffer buf;
+        slot_state     state  = SLOT_FREE;
+        unsigned       frames = 0;
+        size_t         in_words  = 0;
+        size_t         out_words = 0;
+        int            ticket = -1;
+    };
+
+    int  start(slot &s);
+    int  wait_running();
+    int  finish(int ticket, slot *&s);
+    int  load_ram(uint32_t base, const uint32_t *words, unsigned n);
+    uint64_t *in_words(slot &s)  { return static_cast<uint64_t *>(s.buf.data); }
+    uint64_t *out_words(slot &s) { return in_words(s) + s.buf.size / 16; }
+
+    fft_mmio fft_regs_;
+    fft_mmio dma_regs_;
+    int      uio_fd_ = -1;
+    slot     slots_[2];
+    int      running_ = -1;   // slot index owned by the DMA, -1 when idle
+    int      next_ticket_ = 0;
+    uint32_t max_transfer_ = FFT_DMA_MAX_TRANSFER;
+    unsigned len_  = FFT_SIZE;
+    unsigned ctrl_ = 0;
+    unsigned hop_  = 0;
+    unsigned avg_frames_ = 1;
+    float    peak_thresh_ = 0.0f;
+};
+
+#endif // FFT_HOST_H
@@ -1,24 +1,152 @@
 # ==============================================================
 # run_hls.tcl - Vitis HLS 2025.1 Project TCL Script
 # ==============================================================
-# Creates a 256-point Radix-2 DIT FFT HLS Component named "FFT"
+# Creates an FFT_SIZE-point (default 256) FFT HLS Component named "FFT"
 #
 # Usage: vitis_hls -f run_hls.tcl
 #
 # Flow: C Simulation -> C Synthesis -> C/RTL Co-Simulation -> IP Package
+# Sweep: FFT_SWEEP=... compares configurations instead (see Sweep Mode)
 # ==============================================================
 
+# Engine / feature selection passed to both source and testbench (see fft.h)
+# Example: FFT_DEFINES="-DFFT_ENGINE=FFT_ENGINE_SDF -DFFT_SIZE=1024" vitis_hls -f run_hls.tcl
+set fft_defines ""
+if {[info exists ::env(FFT_DEFINES)]} {
+    set fft_defines $::env(FFT_DEFINES)
+}
+
+# Top-level function: fft (AXI-Stream ports) or fft_mm (m_axi frames in DDR)
+# Example: FFT_TOP=fft_mm vitis_hls -f run_hls.tcl
+set fft_top fft
+if {[info exists ::env(FFT_TOP)]} {
+    set fft_top $::env(FFT_TOP)
+}
+if {$fft_top eq "fft_mm"} {
+    append fft_defines " -DFFT_MM=1"
+}
+
+# ==============================================================
+# Sweep Mode: one C sim + synthesis (+ co-sim) per configuration
+# ==============================================================
+# FFT_SWEEP lists configurations separated by ';', each a set of defines
+# added to FFT_DEFINES; "all" selects the engine options below. Each one
+# gets its own project FFT_sweep_<n>, and the worst benchmark SQNR, the
+# latency, interval, worst loop II and resources of every configuration
+# are collected into one table in sweep_report.md. FFT_SWEEP_COSIM=1 adds
+# the co-simulation latency and interval.
+# Example: FFT_SWEEP=all vitis_hls -f run_hls.tcl
+set sweep_all [list \
+    "-DFFT_ENGINE=FFT_ENGINE_MEMORY" \
+    "-DFFT_ENGINE=FFT_ENGINE_MEMORY -DFFT_RADIX=4" \
+    "-DFFT_ENGINE=FFT_ENGINE_MEMORY -DFFT_BFP=1" \
+    "-DFFT_ENGINE=FFT_ENGINE_MEMORY -DFFT_DSP48=1 -DFFT_CMUL_3M=1" \
+    "-DFFT_ENGINE=FFT_ENGINE_MEMORY -DFFT_INPLACE=1" \
+    "-DFFT_ENGINE=FFT_ENGINE_STAGED" \
+    "-DFFT_ENGINE=FFT_ENGINE_SDF" \
+    "-DFFT_ENGINE=FFT_ENGINE_SDF -DFFT_SDF_REORDER=0" \
+    "-DFFT_ENGINE=FFT_ENGINE_SDF -DFFT_SSR=4"]
+
+# Contents of a report file, empty if the step did not produce it
+proc sweep_read {path} {
+    if {![file exists $path]} {
+        return ""
+    }
+    set f [open $path r]
+    set text [read $f]
+    close $f
+    return $text
+}
+
+# First <tag> value in csynth.xml, "-" if absent
+proc sweep_xml {text tag} {
+    if {[regexp "<$tag>(\[^<\]*)</$tag>" $text match value]} {
+        return $value
+    }
+    return "-"
+}
+
+# Smallest (sign -1) or largest (sign 1) capture of pattern in text, "-" if none
+proc sweep_extreme {text pattern sign} {
+    set best "-"
+    foreach {match value} [regexp -all -inline $pattern $text] {
+        if {$best eq "-" || $sign * $value > $sign * $best} {
+            set best $value
+        }
+    }
+    return $best
+}
+
+if {[info exists ::env(FFT_SWEEP)]} {
+    set configs [split $::env(FFT_SWEEP) ";"]
+    if {$::env(FFT_SWEEP) eq "all"} {
+        set configs $sweep_all
+    }
+    set cosim [expr {[info exists ::env(FFT_SWEEP_COSIM)] && $::env(FFT_SWEEP_COSIM)}]
+    set rows {}
+    set n 0
+    foreach config $configs {
+        set defines "$fft_defines $config"
+        set proj "FFT_sweep_$n"
+        puts "=========================================="
+        puts " Sweep $n: $config"
+        puts "=========================================="
+        open_project -reset $proj
+        set_top $fft_top
+        add_files src/fft.cpp -cflags "-std=c++14 -I./src $defines"
+        add_files src/fft_mm.cpp -cflags "-std=c++14 -I./src $defines"
+        add_files -tb src/fft_tb.cpp -cflags "-std=c++14 -I./src $defines"
+        open_solution -reset "solution1" -flow_target vivado
+        set_part {xc7z020clg400-1}
+        create_clock -period 10 -name default
+        set_clock_uncertainty 12.5%
+        # A failing configuration leaves "-" in its row instead of ending the sweep
+        catch {csim_design}
+        catch {csynth_design}
+        if {$cosim} {
+            catch {cosim_design}
+        }
+        close_project
+
+        set csim [sweep_read $proj/solution1/csim/report/${fft_top}_csim.log]
+        set syn  [sweep_read $proj/solution1/syn/report/csynth.xml]
+        set rpt  [sweep_read $proj/solution1/sim/report/${fft_top}_cosim.rpt]
+        set sqnr [sweep_extreme $csim {SQNR +(-?[0-9.]+) dB} -1]
+        set ii   [sweep_extreme $syn {<PipelineII>([0-9]+)</PipelineII>} 1]
+        set co_lat "-"
+        set co_int "-"
+        # | Verilog | Pass | latency min | avg | max | interval min | avg | max |
+        regexp {Verilog\|\s*Pass\|\s*\d+\|\s*(\d+)\|\s*\d+\|\s*\d+\|\s*(\d+)\|} $rpt match co_lat co_int
+        lappend rows [format "| `%s` | %s | %s .. %s | %s .. %s | %s | %s | %s | %s | %s | %s | %s |" \
+            [string trim $config] $sqnr \
+            [sweep_xml $syn Best-caseLatency] [sweep_xml $syn Worst-caseLatency] \
+            [sweep_xml $syn Interval-min] [sweep_xml $syn Interval-max] $ii $co_lat $co_int \
+            [sweep_xml $syn BRAM_18K] [sweep_xml $syn DSP] [sweep_xml $syn FF] [sweep_xml $syn LUT]]
+        incr n
+    }
+
+    set f [open sweep_report.md w]
+    puts $f "| Configuration | SQNR (dB) | Latency (cycles) | Interval | Loop II | Cosim latency | Cosim interval | BRAM_18K | DSP | FF | LUT |"
+    puts $f "|---------------|-----------|------------------|----------|---------|---------------|----------------|----------|-----|----|-----|"
+    foreach row $rows {
+        puts $f $row
+        puts $row
+    }
+    close $f
+    puts "Sweep table written to sweep_report.md"
+    exit
+}
+
 # Create HLS project
 open_project FFT
-
-# Set top-level function
-set_top fft
+set_top $fft_top
 
 # Add source files
-add_files src/fft.cpp -cflags "-I./src"
+add_files src/fft.cpp -cflags "-std=c++14 -I./src $fft_defines"
+add_files src/fft_mm.cpp -cflags "-std=c++14 -I./src $fft_defines"
 
 # Add testbench files
-add_files -tb src/fft_tb.cpp -cflags "-I./src"
+add_files -tb src/fft_tb.cpp -cflags "-std=c++14 -I./src $fft_defines"
 
 # Create solution targeting Vivado flow
 open_solution "solution1" -flow_target vivado
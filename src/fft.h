@@ -1,11 +1,12 @@
 /**
  * @file fft.h
- * @brief 256-point Radix-2 DIT FFT IP Header
+ * @brief N-point FFT IP Header
  *
  * Defines data types and interfaces for the FFT IP core.
+ * - Transform size FFT_SIZE (power of two, 16 .. 4096, default 256)
  * - 64-bit AXI-Stream data: upper 32 bits = real, lower 32 bits = imaginary
  * - 32-bit signed fixed-point format: ap_fixed<32,16>
- * - AXI-Lite control interface for start/stop
+ * - AXI-Lite control interface for start/stop and the runtime length
  */
 
 #ifndef FFT_H
@@ -17,18 +18,525 @@
 #include <ap_axi_sdata.h>
 
 /* ---------- Constants ---------- */
-#define FFT_SIZE      256
+// Transform size, overridable at compile time (e.g. -DFFT_SIZE=1024)
+#ifndef FFT_SIZE
+#define FFT_SIZE 256
+#endif
+
+#if FFT_SIZE == 16
+#define LOG2_FFT_SIZE 4
+#elif FFT_SIZE == 32
+#define LOG2_FFT_SIZE 5
+#elif FFT_SIZE == 64
+#define LOG2_FFT_SIZE 6
+#elif FFT_SIZE == 128
+#define LOG2_FFT_SIZE 7
+#elif FFT_SIZE == 256
 #define LOG2_FFT_SIZE 8
+#elif FFT_SIZE == 512
+#define LOG2_FFT_SIZE 9
+#elif FFT_SIZE == 1024
+#define LOG2_FFT_SIZE 10
+#elif FFT_SIZE == 2048
+#define LOG2_FFT_SIZE 11
+#elif FFT_SIZE == 4096
+#define LOG2_FFT_SIZE 12
+#else
+#error "FFT_SIZE must be a power of two from 16 to 4096"
+#endif
+
+/* ---------- Engine Selection ---------- */
+// Transform architecture behind fft(), chosen at compile time
+// (e.g. -DFFT_ENGINE=FFT_ENGINE_SDF in the run_hls.tcl cflags):
+//   FFT_ENGINE_MEMORY : in-place memory-based radix-2 DIT, one frame per call
+//   FFT_ENGINE_SDF    : radix-2^2 single-path delay feedback pipeline,
+//                       one sample per clock across back-to-back frames
+//   FFT_ENGINE_STAGED : one DATAFLOW process and PIPO buffer per stage,
+//                       a new frame every ~FFT_SIZE cycles for more BRAM
+#define FFT_ENGINE_MEMORY 0
+#define FFT_ENGINE_SDF    1
+#define FFT_ENGINE_STAGED 2
+
+#ifndef FFT_ENGINE
+#define FFT_ENGINE FFT_ENGINE_MEMORY
+#endif
+
+// FFT_SDF_REORDER 0: the SDF engine drops its natural-order reorder buffer
+// (2N samples) and emits bins in digit-reversed order: beat t, lane j holds
+// bin bitrev(t) + FFT_BEATS * j (plain bit-reversed order for FFT_SSR 1).
+#ifndef FFT_SDF_REORDER
+#define FFT_SDF_REORDER 1
+#endif
+
+// Number of fft() calls between a frame entering and its spectrum leaving.
+// The SDF engine keeps its delay lines and reorder buffer across calls, so
+// call k returns the spectrum of the frame passed in call k - 2 (k - 1
+// without the reorder buffer).
+#if FFT_ENGINE == FFT_ENGINE_SDF
+#define FFT_FRAME_LATENCY (FFT_SDF_REORDER ? 2 : 1)
+#else
+#define FFT_FRAME_LATENCY 0
+#endif
+
+/* ---------- Butterfly Radix ---------- */
+// Butterfly kernel of the memory engine:
+//   2 : one radix-2 butterfly per iteration, log2(N) passes
+//   4 : radix-4 butterfly over two radix-2 stages (3 twiddle multiplies
+//       instead of 4, the W_4 rotation is a swap), ceil(log2(N) / 2) passes
+// The SDF engine is radix-2^2 by construction; the staged engine is radix-2.
+#ifndef FFT_RADIX
+#define FFT_RADIX 2
+#endif
+
+#if FFT_RADIX != 2 && FFT_RADIX != 4
+#error "FFT_RADIX must be 2 or 4"
+#endif
+
+#if FFT_RADIX == 4 && FFT_ENGINE != FFT_ENGINE_MEMORY
+#error "FFT_RADIX 4 requires FFT_ENGINE_MEMORY"
+#endif
+
+/* ---------- In-Place Frame Buffer ---------- */
+// FFT_INPLACE 1 gives the memory engine a single frame buffer pair instead
+// of the rev / out PIPO pairs: read_input fills it at bit-reversed
+// addresses, every butterfly pass runs in place and write_output drains
+// it, one after the other. Frames no longer overlap (each takes its read,
+// its passes and its write back to back) but the engine holds two frame
+// arrays instead of eight.
+#ifndef FFT_INPLACE
+#define FFT_INPLACE 0
+#endif
+
+#if FFT_INPLACE && FFT_ENGINE != FFT_ENGINE_MEMORY
+#error "FFT_INPLACE requires FFT_ENGINE_MEMORY"
+#endif
+
+/* ---------- Block Floating Point ---------- */
+// FFT_BFP 1: before every butterfly pass the whole frame is scaled by 2^-s,
+// s = 0 .. 2 (radix-2) or 0 .. 3 (radix-4), chosen from the frame's peak so
+// the pass cannot overflow. The accumulated shift goes out in TUSER on every
+// output beat: spectrum = output * 2^TUSER. Needs a frame-buffered engine.
+#ifndef FFT_BFP
+#define FFT_BFP 0
+#endif
+
+#if FFT_BFP && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_BFP requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+
+// TUSER width: frame exponent with FFT_BFP, absent otherwise
+#define FFT_TUSER_W (FFT_BFP ? 8 : 0)
+
+/* ---------- Real Input ---------- */
+// FFT_REAL 1: each frame is 2 * fft_len real samples packed two per word
+// (x[2n] in the real half, x[2n+1] in the imaginary half). The N-point
+// complex core plus a split stage in the output process returns the
+// fft_len non-redundant bins X[0 .. fft_len-1] of the 2 * fft_len-point
+// real transform, with X[fft_len] (real-valued, Nyquist) in the imaginary
+// half of word 0 next to the real DC bin. Inverse frames stay complex.
+#ifndef FFT_REAL
+#define FFT_REAL 0
+#endif
+
+#if FFT_REAL && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_REAL requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+
+/* ---------- Input Window ---------- */
+// Window multiplier on the input samples of frames with FFT_CTRL_WINDOW set:
+//   FFT_WINDOW_NONE             no multiplier (default)
+//   FFT_WINDOW_HANN / _HAMMING / _BLACKMAN_HARRIS
+//                               built-in ROM, periodic form (fft_window.h)
+//   FFT_WINDOW_RAM              coefficients written over AXI-Lite (window_coef)
+// The window spans the whole frame: FFT_WINDOW_LEN = 2 * FFT_SIZE real
+// samples with FFT_REAL, FFT_SIZE otherwise.
+#define FFT_WINDOW_NONE            0
+#define FFT_WINDOW_HANN            1
+#define FFT_WINDOW_HAMMING         2
+#define FFT_WINDOW_BLACKMAN_HARRIS 3
+#define FFT_WINDOW_RAM             4
+
+#ifndef FFT_WINDOW
+#define FFT_WINDOW FFT_WINDOW_NONE
+#endif
+
+#if FFT_WINDOW < FFT_WINDOW_NONE || FFT_WINDOW > FFT_WINDOW_RAM
+#error "FFT_WINDOW must be one of the FFT_WINDOW_* values"
+#endif
+
+#define FFT_WINDOW_LEN (FFT_REAL ? 2 * FFT_SIZE : FFT_SIZE)
+
+/* ---------- Overlapping Frames (STFT) ---------- */
+// FFT_STFT 1 keeps the last FFT_SIZE input words in an on-chip circular
+// history. Each frame then reads only `hop` new words from the stream and
+// reuses the newest fft_len - hop words of the frames before it, so a
+// spectrogram with 50 / 75 % overlap needs no duplicated input. hop = 0
+// (or >= fft_len) means no overlap; FFT_SSR > 1 rounds it down to whole
+// beats.
+#ifndef FFT_STFT
+#define FFT_STFT 0
+#endif
+
+/* ---------- Fast Convolution ---------- */
+// FFT_FASTCONV 1 turns the IP into an overlap-save FIR filter: each frame is
+// transformed, multiplied bin by bin with the frequency response in the
+// AXI-Lite filter_coef RAM, transformed back, and only its last `hop`
+// samples (the ones free of circular wrap) are emitted. For an M-tap
+// filter set hop = fft_len - M + 1; the STFT history supplies the M - 1
+// overlapping samples, so the stream carries each input sample once.
+#ifndef FFT_FASTCONV
+#define FFT_FASTCONV 0
+#endif
+
+#if FFT_FASTCONV && !FFT_STFT
+#error "FFT_FASTCONV requires FFT_STFT (overlap-save input history)"
+#endif
+#if FFT_FASTCONV && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_FASTCONV requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+#if FFT_FASTCONV && FFT_REAL
+#error "FFT_FASTCONV does not support FFT_REAL"
+#endif
+#if FFT_FASTCONV && FFT_INPLACE
+#error "FFT_FASTCONV needs the spectrum and filtered buffers; FFT_INPLACE has one"
+#endif
+
+/* ---------- Polyphase Filter Bank ---------- */
+// FFT_PFB_TAPS M >= 2 adds a polyphase FIR front end, applied to frames
+// with FFT_CTRL_PFB set, which makes the IP a critically sampled PFB
+// channelizer: input n of a frame of length L becomes
+//   y[n] = sum_m h[m * L + n] * x_(t-M+1+m)[n],  m = 0 .. M-1,
+// where x_t is the block of L samples read with the frame and the others
+// are the M - 1 blocks before it. Each bin is then one output of one
+// channel filtered by the M * L-tap prototype h. The host writes h to the
+// AXI-Lite pfb_coef RAM (pfb_word_t), and a call with FFT_CTRL_PFB_LOAD
+// copies it into M branch memories that are read in parallel, one sample
+// per clock. 0 (default) builds no PFB.
+#ifndef FFT_PFB_TAPS
+#define FFT_PFB_TAPS 0
+#endif
+
+#if FFT_PFB_TAPS == 1 || FFT_PFB_TAPS < 0 || FFT_PFB_TAPS > 8
+#error "FFT_PFB_TAPS must be 0 (off) or 2 to 8"
+#endif
+#if FFT_PFB_TAPS && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_PFB_TAPS requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+#if FFT_PFB_TAPS && (FFT_STFT || FFT_REAL || FFT_WINDOW != FFT_WINDOW_NONE)
+#error "FFT_PFB_TAPS does not support FFT_STFT, FFT_REAL or FFT_WINDOW (the prototype is the window)"
+#endif
+
+/* ---------- Spectrum Output Formats ---------- */
+// FFT_SCALAR_OUT 1 builds the power / magnitude / dB output stage selected
+// per frame by the FFT_CTRL_FMT_* field. Scalar bins go out as IEEE-754
+// floats, two per 64-bit lane, already scaled by the BFP exponent.
+#ifndef FFT_SCALAR_OUT
+#define FFT_SCALAR_OUT 0
+#endif
+
+/* ---------- Spectral Averaging ---------- */
+// FFT_AVG 1 adds an FFT_SIZE-entry power accumulator to the output process
+// and an AXI-Lite avg_frames register K. Frames with a scalar format sum
+// |X|^2 per bin and only every K-th frame is emitted, as the mean (or, with
+// FFT_CTRL_AVG_EXP, an exponential average with weight 1/K) in that
+// format. K = 0 or 1 disables averaging.
+#ifndef FFT_AVG
+#define FFT_AVG 0
+#endif
+
+#if FFT_AVG && !FFT_SCALAR_OUT
+#error "FFT_AVG requires FFT_SCALAR_OUT"
+#endif
+
+#if FFT_AVG && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_AVG requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+
+/* ---------- Peak Detection ---------- */
+// FFT_PEAKS K (1 .. 16) adds a top-K search to the output process. A frame
+// with FFT_CTRL_PEAKS emits K peak records instead of its bins: the K
+// strongest bins whose |X|^2 is at least the AXI-Lite peak_thresh register,
+// strongest first, one word each (pack_peak layout), padded with vacant
+// records (FFT_PEAK_NONE) when fewer bins pass. peak_thresh = 0 gives a
+// plain top-K, a threshold the bins above it (up to K). 0 (default) builds
+// no search.
+#ifndef FFT_PEAKS
+#define FFT_PEAKS 0
+#endif
+
+#if FFT_PEAKS < 0 || FFT_PEAKS > 16
+#error "FFT_PEAKS must be 0 (off) to 16"
+#endif
+#if FFT_PEAKS && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_PEAKS requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+#if FFT_PEAKS && (FFT_FASTCONV || FFT_AVG)
+#error "FFT_PEAKS does not support FFT_FASTCONV or FFT_AVG"
+#endif
+
+/* ---------- Multi-Channel ---------- */
+// FFT_CHANNELS > 1 time-multiplexes that many channels through one engine.
+// axis_t gains TID and TDEST: the TID of a frame's first stream beat picks
+// its channel, and every output beat carries the channel in TID and TDEST.
+// The STFT history and the averaging accumulator are kept per channel.
+#ifndef FFT_CHANNELS
+#define FFT_CHANNELS 1
+#endif
+
+#if FFT_CHANNELS == 1
+#define LOG2_FFT_CHANNELS 0
+#elif FFT_CHANNELS == 2
+#define LOG2_FFT_CHANNELS 1
+#elif FFT_CHANNELS == 4
+#define LOG2_FFT_CHANNELS 2
+#elif FFT_CHANNELS == 8
+#define LOG2_FFT_CHANNELS 3
+#elif FFT_CHANNELS == 16
+#define LOG2_FFT_CHANNELS 4
+#else
+#error "FFT_CHANNELS must be 1, 2, 4, 8 or 16"
+#endif
+
+#if FFT_CHANNELS > 1 && FFT_STFT && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_STFT with FFT_CHANNELS > 1 requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+
+// TID / TDEST width: channel number with FFT_CHANNELS > 1, absent otherwise
+#define FFT_TID_W LOG2_FFT_CHANNELS
+
+/* ---------- Performance Counters ---------- */
+// FFT_PERF adds a read-only AXI-Lite counter bank (perf, FFT_PERF_* below):
+// the last frame's interval and the loop cycles of its input, butterfly
+// and output processes, input-starved and output-stalled cycles, frames
+// completed and butterflies that overflowed. The stream
+// loops poll instead of blocking, so the SDF engine, whose rewound loop
+// must move a beat every cycle, is not supported.
+#ifndef FFT_PERF
+#define FFT_PERF 0
+#endif
+
+#if FFT_PERF && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_PERF requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED"
+#endif
+
+/* ---------- Memory-Mapped Top ---------- */
+// FFT_MM 1 declares fft_mm (fft_mm.cpp), which bursts frames from and to
+// DDR over two m_axi ports instead of using the AXI-Stream ports, so no
+// external DMA is needed. run_hls.tcl sets it with FFT_TOP=fft_mm.
+// FFT_MM_DEPTH is the co-simulation depth of each port in beats: 8 frames,
+// or the 2 * FFT_CHANNELS + 1 of the testbench's multi-channel averaging
+// batch if that is more.
+#ifndef FFT_MM
+#define FFT_MM 0
+#endif
+
+#ifndef FFT_MM_DEPTH
+#define FFT_MM_DEPTH ((2 * FFT_CHANNELS + 1 > 8 ? 2 * FFT_CHANNELS + 1 : 8) * FFT_BEATS)
+#endif
+
+#if FFT_MM && FFT_BFP
+#error "FFT_MM stores data words only; FFT_BFP needs the TUSER exponent of the fft top"
+#endif
+
+/* ---------- Multi-Engine ---------- */
+// FFT_ENGINES > 1 puts that many memory or staged engines behind the one
+// stream pair: whole frames are dealt out round-robin, as ap_axiu beats,
+// and the results are collected in the same order, so no reorder buffer is
+// needed and a batch runs up to FFT_ENGINES times faster. Every engine has
+// its own twiddle ROM, which keeps two butterfly ports per engine. State
+// that links frames or is shared by the engines (STFT history, averaging,
+// performance counters, the window, filter and PFB RAMs) is not supported.
+#ifndef FFT_ENGINES
+#define FFT_ENGINES 1
+#endif
+
+#if FFT_ENGINES < 1 || FFT_ENGINES > 8
+#error "FFT_ENGINES must be 1 to 8"
+#endif
+
+#if FFT_ENGINES > 1 && FFT_ENGINE == FFT_ENGINE_SDF
+#error "FFT_ENGINES > 1 requires FFT_ENGINE_MEMORY or FFT_ENGINE_STAGED (use FFT_SSR to widen SDF)"
+#endif
+
+#if FFT_ENGINES > 1 && (FFT_STFT || FFT_AVG || FFT_PERF || FFT_WINDOW == FFT_WINDOW_RAM || FFT_PFB_TAPS)
+#error "FFT_ENGINES > 1 does not support FFT_STFT, FFT_AVG, FFT_PERF, FFT_WINDOW_RAM or FFT_PFB_TAPS"
+#endif
+
+/* ---------- Super-Sample Rate ---------- */
+// Complex samples per AXI-Stream beat. FFT_SSR > 1 widens axis_t to
+// 64 * FFT_SSR bits (lane l in bits [64l+63 : 64l], pack_data layout per
+// lane) and runs FFT_SSR parallel lane pipelines in the SDF engine.
+#ifndef FFT_SSR
+#define FFT_SSR 1
+#endif
+
+#if FFT_SSR == 1
+#define LOG2_FFT_SSR 0
+#elif FFT_SSR == 2
+#define LOG2_FFT_SSR 1
+#elif FFT_SSR == 4
+#define LOG2_FFT_SSR 2
+#elif FFT_SSR == 8
+#define LOG2_FFT_SSR 3
+#else
+#error "FFT_SSR must be 1, 2, 4 or 8"
+#endif
+
+#if FFT_SSR > 1 && FFT_ENGINE != FFT_ENGINE_SDF
+#error "FFT_SSR > 1 requires FFT_ENGINE_SDF"
+#endif
+
+// Window coefficients cover two samples per clock (one RAM word)
+#if FFT_WINDOW != FFT_WINDOW_NONE && FFT_SSR > 2
+#error "FFT_WINDOW supports FFT_SSR 1 or 2"
+#endif
+
+// AXI-Stream beats per frame
+#define FFT_BEATS      (FFT_SIZE / FFT_SSR)
+#define LOG2_FFT_BEATS (LOG2_FFT_SIZE - LOG2_FFT_SSR)
+
+/* ---------- Datapath Precision ---------- */
+// Internal sample / twiddle formats (the AXI word stays fixed_t pack_data).
+// FFT_DSP48 1 selects 25-bit samples and 18-bit twiddles, so every real
+// twiddle multiply fits a single DSP48E1 25 x 18 multiplier instead of a
+// cascade. The individual widths can also be set directly.
+#ifndef FFT_DSP48
+#define FFT_DSP48 0
+#endif
+
+#if FFT_DSP48
+#define FFT_DATA_W_DEFAULT    25
+#define FFT_TWIDDLE_W_DEFAULT 18
+#define FFT_TWIDDLE_I_DEFAULT 2
+#else
+#define FFT_DATA_W_DEFAULT    32
+#define FFT_TWIDDLE_W_DEFAULT 32
+#define FFT_TWIDDLE_I_DEFAULT 16
+#endif
+
+#ifndef FFT_DATA_W
+#define FFT_DATA_W FFT_DATA_W_DEFAULT
+#endif
+#ifndef FFT_DATA_I
+#define FFT_DATA_I 16
+#endif
+#ifndef FFT_TWIDDLE_W
+#define FFT_TWIDDLE_W FFT_TWIDDLE_W_DEFAULT
+#endif
+#ifndef FFT_TWIDDLE_I
+#define FFT_TWIDDLE_I FFT_TWIDDLE_I_DEFAULT
+#endif
+
+/* ---------- Twiddle Storage ---------- */
+// FFT_TWIDDLE_OCTANT 1: store cos/sin over one octant (M/8 + 1 entries
+// each, 33 for N = 256) and rebuild the other octants with index folding
+// and sign/swap logic, so twiddle tables fit in LUTs instead of BRAM.
+#ifndef FFT_TWIDDLE_OCTANT
+#define FFT_TWIDDLE_OCTANT 0
+#endif
+
+/* ---------- Complex Multiplier ---------- */
+// FFT_CMUL_3M 1: three-multiply (Gauss) twiddle product using re + im and
+// im - re from the twiddle ROM, 25% fewer DSPs per complex multiply. The
+// data pre-add ar + ai is one bit wider than sample_t.
+#ifndef FFT_CMUL_3M
+#define FFT_CMUL_3M 0
+#endif
 
 /* ---------- Type Definitions ---------- */
 // 32-bit signed fixed-point: 16 integer bits (including sign), 16 fractional bits
 typedef ap_fixed<32, 16> fixed_t;
 
+// Internal sample type of fft_core<> (buffers, delay lines, butterflies)
+typedef ap_fixed<FFT_DATA_W, FFT_DATA_I> sample_t;
+
+// Twiddle factor ROM entries
+typedef ap_fixed<FFT_TWIDDLE_W, FFT_TWIDDLE_I> twiddle_t;
+
 // 64-bit unsigned integer for packed complex data
 typedef ap_uint<64> data_t;
 
-// AXI-Stream packet type (64-bit data, no TUSER/TID/TDEST)
-typedef ap_axiu<64, 0, 0, 0> axis_t;
+// One AXI-Stream beat: FFT_SSR packed complex samples
+typedef ap_uint<64 * FFT_SSR> beat_t;
+
+// Runtime transform length register (points, 16 .. FFT_SIZE)
+typedef ap_uint<LOG2_FFT_SIZE + 1> fft_len_t;
+
+// Block exponent: frame scale is 2^exp (FFT_BFP); negative after 1/N scaling
+typedef ap_int<8> bfp_exp_t;
+
+// Runtime control register, sampled once per frame
+typedef ap_uint<16> fft_ctrl_t;
+#define FFT_CTRL_INVERSE    0x1   // inverse transform: conj(FFT(conj(x)))
+#define FFT_CTRL_SCALE      0x2   // with FFT_CTRL_INVERSE: scale the result by 1/length
+#define FFT_CTRL_BITREV_IN  0x4   // input arrives in bit-reversed order (memory / staged)
+#define FFT_CTRL_BITREV_OUT 0x8   // emit bins in bit-reversed order (memory / staged)
+#define FFT_CTRL_WINDOW     0x10  // multiply the input by the FFT_WINDOW coefficients
+#define FFT_CTRL_FORMAT     0x60  // output format field (FFT_SCALAR_OUT):
+#define FFT_CTRL_FMT_COMPLEX 0x00 //   complex bins, pack_data layout
+#define FFT_CTRL_FMT_POWER   0x20 //   |X|^2
+#define FFT_CTRL_FMT_MAG     0x40 //   |X| (CORDIC)
+#define FFT_CTRL_FMT_DB      0x60 //   10 * log10(|X|^2)
+#define FFT_CTRL_HALF       0x80  // emit only the first half of the bins
+#define FFT_CTRL_BATCH_TLAST 0x100 // one TLAST at the end of a num_frames batch
+#define FFT_CTRL_AVG_EXP    0x200 // exponential instead of block average (FFT_AVG)
+#define FFT_CTRL_PERF_CLEAR 0x400 // zero the FFT_PERF totals before this call
+#define FFT_CTRL_PFB        0x800 // filter the input through the PFB front end
+#define FFT_CTRL_PFB_LOAD   0x1000 // copy pfb_coef into the PFB branches first
+#define FFT_CTRL_PEAKS      0x2000 // emit FFT_PEAKS peak records instead of the bins
+
+// Frame count register: frames per call (0 and 1 both select one frame)
+typedef ap_uint<16> fft_frames_t;
+
+// STFT hop register: new input words per frame (FFT_STFT)
+typedef ap_uint<LOG2_FFT_SIZE + 1> fft_hop_t;
+
+// Peak threshold register (FFT_PEAKS): least |X|^2 of a reported bin
+typedef float fft_thresh_t;
+
+// Bin field of a vacant peak record
+#define FFT_PEAK_NONE 0xFFFFFFFFu
+
+// Performance counter register (FFT_PERF); perf[] indices
+typedef ap_uint<32> fft_perf_t;
+#define FFT_PERF_CYCLES      0   // last frame's interval (sum with FFT_INPLACE) of 5 .. 7
+#define FFT_PERF_IN_STALL    1   // input loop cycles without an input beat
+#define FFT_PERF_OUT_STALL   2   // output loop cycles blocked by back-pressure
+#define FFT_PERF_FRAMES      3   // frames completed
+#define FFT_PERF_OVERFLOW    4   // butterflies whose sum or difference wrapped
+#define FFT_PERF_IN_CYCLES   5   // last frame's input loop cycles
+#define FFT_PERF_BFLY_CYCLES 6   // last frame's longest butterfly (or filter) process
+#define FFT_PERF_OUT_CYCLES  7   // last frame's output loop cycles
+#define FFT_PERF_REGS        8
+
+// Memory-mapped word count (FFT_MM)
+typedef ap_uint<32> fft_words_t;
+
+// Channel number (FFT_CHANNELS)
+typedef ap_uint<(LOG2_FFT_CHANNELS > 0) ? LOG2_FFT_CHANNELS : 1> fft_chan_t;
+
+// Window coefficient, unsigned Q1.15 (1.0 = 0x8000)
+typedef ap_ufixed<16, 1> window_t;
+
+// Window RAM word: coefficient 2m in bits [15:0], 2m + 1 in bits [31:16]
+typedef ap_uint<32> window_word_t;
+
+// Filter response coefficient (FFT_FASTCONV), signed Q2.14
+typedef ap_fixed<16, 2> filter_t;
+
+// Filter RAM word: H[k] real part in bits [31:16], imaginary in [15:0]
+typedef ap_uint<32> filter_word_t;
+
+// PFB prototype coefficient (FFT_PFB_TAPS), signed Q2.14
+typedef ap_fixed<16, 2> pfb_coef_t;
+
+// PFB RAM word m * FFT_SIZE / 2 + w: branch m, coefficients 2w in bits
+// [15:0] and 2w + 1 in bits [31:16] (h[m * L + 2w] and h[m * L + 2w + 1])
+typedef ap_uint<32> pfb_word_t;
+
+// AXI-Stream packet type (64-bit data per lane, TUSER = signed exponent with
+// FFT_BFP, TID / TDEST = channel with FFT_CHANNELS > 1)
+typedef ap_axiu<64 * FFT_SSR, FFT_TUSER_W, FFT_TID_W, FFT_TID_W> axis_t;
 
 /* ---------- Helper Functions ---------- */
 
@@ -58,18 +566,192 @@ inline void unpack_data(data_t packed, fixed_t &real_val, fixed_t &imag_val) {
     imag_val.range() = imag_bits;
 }
 
+/**
+ * @brief IEEE-754 bit pattern of a float
+ */
+inline ap_uint<32> float_bits(float f) {
+    union { float f; unsigned int u; } conv;
+    conv.f = f;
+    return conv.u;
+}
+
+/**
+ * @brief Float with the given IEEE-754 bit pattern
+ */
+inline float bits_float(ap_uint<32> bits) {
+    union { float f; unsigned int u; } conv;
+    conv.u = bits.to_uint();
+    return conv.f;
+}
+
+/**
+ * @brief Pack one complex sample into lane `lane` of an AXI-Stream beat
+ * @param beat     Beat being assembled
+ * @param lane     Lane index 0 .. FFT_SSR-1 (sample lane + FFT_SSR * beat)
+ * @param real_val 32-bit signed fixed-point real part
+ * @param imag_val 32-bit signed fixed-point imaginary part
+ */
+inline void pack_lane(beat_t &beat, int lane, fixed_t real_val, fixed_t imag_val) {
+    beat.range(64 * lane + 63, 64 * lane) = pack_data(real_val, imag_val);
+}
+
+/**
+ * @brief Unpack lane `lane` of an AXI-Stream beat into a complex sample
+ * @param beat     Received beat
+ * @param lane     Lane index 0 .. FFT_SSR-1
+ * @param real_val Output: 32-bit signed fixed-point real part
+ * @param imag_val Output: 32-bit signed fixed-point imaginary part
+ */
+inline void unpack_lane(beat_t beat, int lane, fixed_t &real_val, fixed_t &imag_val) {
+    data_t packed = beat.range(64 * lane + 63, 64 * lane);
+    unpack_data(packed, real_val, imag_val);
+}
+
+/**
+ * @brief Pack two consecutive scalar bins into lane `lane` (FFT_SCALAR_OUT)
+ * @param beat   Beat being assembled
+ * @param lane   Lane index 0 .. FFT_SSR-1
+ * @param first  Lower bin, upper 32 bits (where pack_data puts the real part)
+ * @param second Next bin, lower 32 bits
+ */
+inline void pack_scalars(beat_t &beat, int lane, float first, float second) {
+    beat.range(64 * lane + 63, 64 * lane + 32) = float_bits(first);
+    beat.range(64 * lane + 31, 64 * lane)      = float_bits(second);
+}
+
+/**
+ * @brief Unpack the two scalar bins of lane `lane` (FFT_SCALAR_OUT)
+ */
+inline void unpack_scalars(beat_t beat, int lane, float &first, float &second) {
+    first  = bits_float(beat.range(64 * lane + 63, 64 * lane + 32));
+    second = bits_float(beat.range(64 * lane + 31, 64 * lane));
+}
+
+/**
+ * @brief Pack a peak record (FFT_PEAKS)
+ * @param power |X|^2 of the bin as a float, upper 32 bits
+ * @param bin   Bin index (FFT_PEAK_NONE for a vacant record), lower 32 bits
+ */
+inline data_t pack_peak(float power, ap_uint<32> bin) {
+    data_t packed;
+    packed.range(63, 32) = float_bits(power);
+    packed.range(31, 0)  = bin;
+    return packed;
+}
+
+/**
+ * @brief Unpack a peak record (FFT_PEAKS)
+ */
+inline void unpack_peak(data_t packed, float &power, ap_uint<32> &bin) {
+    power = bits_float(packed.range(63, 32));
+    bin   = packed.range(31, 0);
+}
+
 /* ---------- Top-Level Function ---------- */
 
 /**
- * @brief 256-point Radix-2 DIT FFT
+ * @brief FFT_SIZE-point FFT
  *
- * Reads 256 complex samples from AXI-Stream input (TLAST=1 on last),
- * computes the FFT using bit-reversal and 8 butterfly stages,
- * and writes 256 complex results to AXI-Stream output (TLAST=1 on last).
+ * Reads num_frames frames of fft_len complex samples from AXI-Stream input,
+ * computes the FFT with fft_core<FFT_SIZE, sample_t, twiddle_t>,
+ * and writes fft_len complex results per frame to AXI-Stream output (TLAST=1
+ * on the last of each frame, or of the batch with FFT_CTRL_BATCH_TLAST).
+ * Shorter frames skip the unused stages and finish proportionally sooner.
+ * With FFT_ENGINE_SDF the output lags the input by FFT_FRAME_LATENCY calls,
+ * and with FFT_SSR > 1 each beat carries FFT_SSR consecutive samples.
+ * With FFT_FASTCONV each frame instead yields its last hop samples of the
+ * filtered signal, and FFT_CTRL_PEAKS frames (FFT_PEAKS) yield FFT_PEAKS
+ * peak records.
  *
  * @param in_stream  AXI-Stream input (64-bit packed complex data)
  * @param out_stream AXI-Stream output (64-bit packed complex data)
+ * @param fft_len    AXI-Lite register: transform length, a power of two from
+ *                   16 to FFT_SIZE (0 selects FFT_SIZE). The SDF engine always
+ *                   runs FFT_SIZE points.
+ * @param ctrl       AXI-Lite register: FFT_CTRL_* bits, so direction, bin
+ *                   order and windowing can change from frame to frame
+ * @param num_frames AXI-Lite register: back-to-back frames per start, all with
+ *                   the same fft_len and ctrl
+ * @param hop        AXI-Lite register (FFT_STFT only): new input words per
+ *                   frame, the rest of the frame is taken from the history
+ * @param avg_frames AXI-Lite register (FFT_AVG only): power spectra averaged
+ *                   per output frame
+ * @param peak_thresh AXI-Lite register (FFT_PEAKS only): least |X|^2 of a
+ *                   bin in the peak records of FFT_CTRL_PEAKS frames
+ * @param perf       AXI-Lite registers (FFT_PERF only, read-only): counters
+ *                   indexed by FFT_PERF_*, cleared by FFT_CTRL_PERF_CLEAR
+ * @param filter_coef AXI-Lite RAM (FFT_FASTCONV only): frequency response
+ *                   H[k] of the active length, one bin per word (filter_word_t)
+ * @param pfb_coef   AXI-Lite RAM (FFT_PFB_TAPS only): PFB prototype of the
+ *                   active length, branch by branch (pfb_word_t)
+ * @param window_coef AXI-Lite RAM (FFT_WINDOW_RAM only): window samples of
+ *                   the active length, two per word (window_word_t)
+ */
+void fft(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream,
+         fft_len_t fft_len, fft_ctrl_t ctrl, fft_frames_t num_frames
+#if FFT_STFT
+         , fft_hop_t hop
+#endif
+#if FFT_AVG
+         , fft_frames_t avg_frames
+#endif
+#if FFT_PEAKS
+         , fft_thresh_t peak_thresh
+#endif
+#if FFT_PERF
+         , fft_perf_t perf[FFT_PERF_REGS]
+#endif
+#if FFT_FASTCONV
+         , const filter_word_t filter_coef[FFT_SIZE]
+#endif
+#if FFT_PFB_TAPS
+         , const pfb_word_t pfb_coef[FFT_PFB_TAPS * FFT_SIZE / 2]
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+         , const window_word_t window_coef[FFT_WINDOW_LEN / 2]
+#endif
+         );
+
+#if FFT_MM
+/**
+ * @brief FFT_SIZE-point FFT on frames in DDR (FFT_MM)
+ *
+ * Same engine and AXI-Lite registers as fft, but the frames come from `src`
+ * and the results go to `dst` over m_axi bursts, one beat_t per word:
+ * num_frames frames of fft_len / FFT_SSR words in (hop words with FFT_STFT
+ * overlap), frame f with channel f % FFT_CHANNELS. The output is packed
+ * back to back exactly as fft would stream it in a FFT_CTRL_BATCH_TLAST
+ * batch, and out_words reports its length. The other optional arguments
+ * are those of fft.
+ *
+ * @param src       AXI-Lite address register + m_axi read port: input frames
+ * @param dst       AXI-Lite address register + m_axi write port: results
+ * @param out_words AXI-Lite register (read-only): words written to dst
  */
-void fft(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream);
+void fft_mm(const beat_t *src, beat_t *dst, fft_len_t fft_len, fft_ctrl_t ctrl,
+            fft_frames_t num_frames, fft_words_t &out_words
+#if FFT_STFT
+            , fft_hop_t hop
+#endif
+#if FFT_AVG
+            , fft_frames_t avg_frames
+#endif
+#if FFT_PEAKS
+            , fft_thresh_t peak_thresh
+#endif
+#if FFT_PERF
+            , fft_perf_t perf[FFT_PERF_REGS]
+#endif
+#if FFT_FASTCONV
+            , const filter_word_t filter_coef[FFT_SIZE]
+#endif
+#if FFT_PFB_TAPS
+            , const pfb_word_t pfb_coef[FFT_PFB_TAPS * FFT_SIZE / 2]
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+            , const window_word_t window_coef[FFT_WINDOW_LEN / 2]
+#endif
+            );
+#endif
 
 #endif // FFT_H
@@ -0,0 +1,2213 @@
+/**
+ * @file fft_core.h
+ * @brief Templated FFT engines: fft_core<N, DataT, TwiddleT>
+ *
+ * Header-only so any top-level function can instantiate right-sized
+ * engines from one source:
+ *   - N        transform size, power of two (16 .. 4096)
+ *   - DataT    internal sample type for buffers and butterflies
+ *   - TwiddleT twiddle ROM type, generated at compile time (fft_twiddle.h)
+ *
+ * Samples cross the AXI-Stream boundary in the fixed_t pack_data format
+ * whatever DataT is. The architecture is selected by FFT_ENGINE (fft.h).
+ */
+
+#ifndef FFT_CORE_H
+#define FFT_CORE_H
+
+#include "fft.h"
+#include "fft_twiddle.h"
+#include "fft_window.h"
+#if FFT_SCALAR_OUT || FFT_PEAKS
+#include <hls_math.h>
+#endif
+
+// Window coefficient RAM, threaded from the top level to the input process
+#if FFT_WINDOW == FFT_WINDOW_RAM
+#define FFT_WIN_PARAM(N) , const window_word_t window_coef[FFT_REAL ? (N) : (N) / 2]
+#define FFT_WIN_ARG      , window_coef
+#else
+#define FFT_WIN_PARAM(N)
+#define FFT_WIN_ARG
+#endif
+
+// Filter response RAM, threaded from the top level to the multiply process
+#if FFT_FASTCONV
+#define FFT_FILT_PARAM(N) , const filter_word_t filter_coef[N]
+#define FFT_FILT_ARG      , filter_coef
+#else
+#define FFT_FILT_PARAM(N)
+#define FFT_FILT_ARG
+#endif
+
+// PFB prototype RAM, threaded from the top level to the input process
+#if FFT_PFB_TAPS
+#define FFT_PFB_PARAM(N) , const pfb_word_t pfb_coef[FFT_PFB_TAPS * (N) / 2]
+#define FFT_PFB_ARG      , pfb_coef
+#else
+#define FFT_PFB_PARAM(N)
+#define FFT_PFB_ARG
+#endif
+
+// Peak threshold register, threaded from the top level to the output process
+#if FFT_PEAKS
+#define FFT_PEAK_PARAM , fft_thresh_t peak_thresh
+#define FFT_PEAK_ARG   , peak_thresh
+#else
+#define FFT_PEAK_PARAM
+#define FFT_PEAK_ARG
+#endif
+
+// Performance counter registers, threaded from the top level to the output process
+#if FFT_PERF
+#define FFT_PERF_PARAM , fft_perf_t perf[FFT_PERF_REGS]
+#define FFT_PERF_ARG   , perf
+#else
+#define FFT_PERF_PARAM
+#define FFT_PERF_ARG
+#endif
+
+// Frame token streams between the DATAFLOW processes (FFT_BFP, FFT_PERF)
+#if FFT_BFP
+#define FFT_BFP_IO(a, b) , a, b
+#define FFT_BFP_IN(a)    , a
+#else
+#define FFT_BFP_IO(a, b)
+#define FFT_BFP_IN(a)
+#endif
+#if FFT_PERF
+#define FFT_PERF_IO(a, b) , a, b
+#define FFT_PERF_IN(a)    , a
+#else
+#define FFT_PERF_IO(a, b)
+#define FFT_PERF_IN(a)
+#endif
+
+/* ================================================================
+ *  Common Helpers
+ * ================================================================ */
+
+/**
+ * @brief Compute bit-reversed index for a BITS-bit value
+ */
+template <int BITS>
+static ap_uint<BITS> bit_reverse_idx(ap_uint<BITS> idx) {
+    #pragma HLS INLINE
+    ap_uint<BITS> rev = 0;
+    for (int i = 0; i < BITS; i++) {
+        #pragma HLS UNROLL
+        rev[BITS - 1 - i] = idx[i];
+    }
+    return rev;
+}
+
+/**
+ * @brief Channel tag of a beat (TID with FFT_CHANNELS > 1, else 0)
+ */
+static fft_chan_t axis_chan(const axis_t &val) {
+    #pragma HLS INLINE
+#if FFT_CHANNELS > 1
+    return val.id;
+#else
+    (void)val;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Tag an output beat with its channel in TID and TDEST (FFT_CHANNELS > 1)
+ */
+static void axis_set_chan(axis_t &val, fft_chan_t chan) {
+    #pragma HLS INLINE
+#if FFT_CHANNELS > 1
+    val.id   = chan;
+    val.dest = chan;
+#else
+    (void)val;
+    (void)chan;
+#endif
+}
+
+/**
+ * @brief log2 of the active transform length, 4 .. log2(N)
+ */
+typedef ap_uint<5> log2_len_t;
+
+/**
+ * @brief Decode the runtime length register into log2 of the active length
+ *
+ * Non-powers of two round down; 0 selects N and values below 16 select 16.
+ */
+template <int N>
+static log2_len_t decode_log2_len(ap_uint<fft_log2(N) + 1> len) {
+    #pragma HLS INLINE
+    log2_len_t log2_len = fft_log2(N);
+    if (len != 0) {
+        DECODE_LEN_LOOP: for (int b = 4; b < fft_log2(N); b++) {
+            #pragma HLS UNROLL
+            if ((len >> b) == 1) log2_len = b;
+        }
+        if ((len >> 4) == 0) log2_len = 4;
+    }
+    return log2_len;
+}
+
+/**
+ * @brief Complex multiply (ar + j*ai) * W, products cast to DataT
+ *
+ * FFT_CMUL_3M selects the Gauss form with the twiddle sum / difference
+ * taken from the ROM: three real multiplies and three adds instead of
+ * four multiplies and two adds.
+ */
+template <typename DataT, typename TwiddleT>
+static void complex_mul(DataT ar, DataT ai, const twiddle_pt<TwiddleT> &w,
+                        DataT &pr, DataT &pi) {
+    #pragma HLS INLINE
+#if FFT_CMUL_3M
+    DataT k1 = (DataT)(w.re * (ar + ai));   // re*ar + re*ai
+    DataT k2 = (DataT)(ar * w.dif);         // ar*im - ar*re
+    DataT k3 = (DataT)(ai * w.sum);         // ai*re + ai*im
+    pr = k1 - k3;
+    pi = k1 + k2;
+#else
+    pr = (DataT)(ar * w.re) - (DataT)(ai * w.im);
+    pi = (DataT)(ar * w.im) + (DataT)(ai * w.re);
+#endif
+}
+
+/* ================================================================
+ *  Transform Direction (FFT_CTRL_INVERSE)
+ *
+ *  IFFT(x) = conj(FFT(conj(x))): an inverse frame negates the imaginary
+ *  part on the way in and again on the way out, so every engine (and
+ *  the SDF -j rotations) runs unchanged and the direction can change on
+ *  any frame boundary.
+ * ================================================================ */
+
+/**
+ * @brief Conjugate an input sample of an inverse frame
+ */
+template <typename DataT>
+static DataT inverse_input(fixed_t im, fft_ctrl_t ctrl) {
+    #pragma HLS INLINE
+    return (ctrl & FFT_CTRL_INVERSE) ? (DataT)-im : (DataT)im;
+}
+
+/**
+ * @brief Conjugate an output sample of an inverse frame and apply 1/2^shift
+ */
+template <typename DataT>
+static void inverse_output(DataT &re, DataT &im, fft_ctrl_t ctrl, log2_len_t shift) {
+    #pragma HLS INLINE
+    if (ctrl & FFT_CTRL_INVERSE) {
+        im = -im;
+        if (ctrl & FFT_CTRL_SCALE) {
+            re = re >> shift;
+            im = im >> shift;
+        }
+    }
+}
+
+/**
+ * @brief Weight word i of a frame by the input window (FFT_CTRL_WINDOW)
+ *
+ * With FFT_REAL word i carries window samples 2i and 2i + 1 of the
+ * 2^(log2_len + 1)-point real frame; otherwise sample i takes one half
+ * of coefficient pair i / 2.
+ */
+template <int N, typename DataT>
+static void window_input(DataT &xr, DataT &xi, ap_uint<fft_log2(N)> i,
+                         log2_len_t log2_len, fft_ctrl_t ctrl FFT_WIN_PARAM(N)) {
+    #pragma HLS INLINE
+#if FFT_WINDOW != FFT_WINDOW_NONE
+    if (ctrl & FFT_CTRL_WINDOW) {
+        window_t w0, w1;
+#if FFT_REAL
+        window_pair<2 * N>(i, log2_len + 1 FFT_WIN_ARG, w0, w1);
+        xr = (DataT)(xr * w0);
+        xi = (DataT)(xi * w1);
+#else
+        window_pair<N>(i >> 1, log2_len FFT_WIN_ARG, w0, w1);
+        window_t w = i[0] ? w1 : w0;
+        xr = (DataT)(xr * w);
+        xi = (DataT)(xi * w);
+#endif
+    }
+#else
+    (void)xr; (void)xi; (void)i; (void)log2_len; (void)ctrl;
+#endif
+}
+
+/* ================================================================
+ *  Overlapping Frames (FFT_STFT)
+ *
+ *  The last N / FFT_SSR input beats are kept in a circular history of
+ *  full beats. A frame of `beats` beats with hop h starts at entry
+ *  wp - (beats - h): its first beats - h beats are the newest history
+ *  beats, the last h beats come from the stream and are recorded at
+ *  wp .. wp + h - 1, and wp then advances by h. Every beat is a single
+ *  history access, so the input loops keep II=1. Each channel has its
+ *  own history and wp.
+ * ================================================================ */
+
+/**
+ * @brief New beats per frame: hop rounded down to beats, beats if 0 or too long
+ */
+static int stft_hop_beats(fft_hop_t hop, int beats) {
+    #pragma HLS INLINE
+#if FFT_STFT
+    int h = hop >> LOG2_FFT_SSR;
+    return (h == 0 || h > beats) ? beats : h;
+#else
+    (void)hop;
+    return beats;
+#endif
+}
+
+/**
+ * @brief Data of beat b of a frame, from the stream or the STFT history
+ *
+ * chan takes the TID of every stream beat and selects the history, so
+ * with FFT_CHANNELS > 1 a frame has to read a stream beat first.
+ * frame_end marks the frame's last access and advances wp.
+ */
+template <int N>
+static beat_t stft_read(hls::stream<axis_t> &in_stream, int b, int beats, int hop_beats,
+                        bool frame_end, fft_chan_t &chan) {
+    #pragma HLS INLINE
+#if FFT_STFT
+    const int HIST = N / FFT_SSR;
+    static beat_t hist[FFT_CHANNELS * HIST];
+    static ap_uint<fft_log2(HIST)> wp[FFT_CHANNELS];
+    #pragma HLS ARRAY_PARTITION variable=wp complete
+    // Entries of earlier frames are never rewritten within a frame
+    #pragma HLS DEPENDENCE variable=hist inter false
+
+    beat_t data = 0;
+    bool   from_stream = b >= beats - hop_beats;
+    if (from_stream) {
+        axis_t val = in_stream.read();
+        data = val.data;
+        chan = axis_chan(val);
+    }
+    ap_uint<fft_log2(HIST)> idx = wp[chan] - (beats - hop_beats) + b;
+    int addr = chan * HIST + idx;
+    if (from_stream) {
+        hist[addr] = data;
+    } else {
+        data = hist[addr];
+    }
+    if (frame_end) wp[chan] += hop_beats;
+    return data;
+#else
+    (void)b;
+    (void)beats;
+    (void)hop_beats;
+    (void)frame_end;
+    axis_t val = in_stream.read();
+    chan = axis_chan(val);
+    return val.data;
+#endif
+}
+
+/* ================================================================
+ *  Polyphase Filter Bank (FFT_PFB_TAPS)
+ *
+ *  With M = FFT_PFB_TAPS, the M - 1 blocks before the current one sit in
+ *  M - 1 slot memories (per channel, L samples each): slot (wp + j) mod
+ *  (M - 1) holds block t - M + 1 + j. Sample n reads every slot at n once
+ *  and every branch memory h[m] at n once, so the M products are formed
+ *  in one cycle; then the new sample replaces the oldest block's in slot
+ *  wp, and wp advances at the end of the frame. The history is recorded
+ *  on every frame, so FFT_CTRL_PFB can be switched on at any frame.
+ * ================================================================ */
+
+#if FFT_PFB_TAPS
+/**
+ * @brief Copy the AXI-Lite prototype RAM into the branch memories
+ */
+template <int N>
+static void pfb_load_branches(pfb_coef_t h[FFT_PFB_TAPS][N], const pfb_word_t pfb_coef[FFT_PFB_TAPS * N / 2]) {
+    PFB_LOAD_LOOP: for (int a = 0; a < FFT_PFB_TAPS * N / 2; a++) {
+        #pragma HLS PIPELINE II=1
+        const int  m = a / (N / 2);
+        const int  n = 2 * (a % (N / 2));
+        pfb_word_t w = pfb_coef[a];
+        h[m][n].range()     = w.range(15, 0);
+        h[m][n + 1].range() = w.range(31, 16);
+    }
+}
+
+/**
+ * @brief Replace input sample n of a frame with its polyphase sum
+ *
+ * Also records the sample in the history. frame_end marks the last
+ * sample of the frame and advances wp.
+ */
+template <int N, typename DataT>
+static void pfb_filter(DataT &xr, DataT &xi, ap_uint<fft_log2(N)> n, bool frame_end,
+                       fft_chan_t chan, fft_ctrl_t ctrl, const pfb_coef_t h[FFT_PFB_TAPS][N]) {
+    #pragma HLS INLINE
+    const int S = FFT_PFB_TAPS - 1;
+    static DataT hist_re[S][FFT_CHANNELS * N], hist_im[S][FFT_CHANNELS * N];
+    #pragma HLS ARRAY_PARTITION variable=hist_re complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=hist_im complete dim=1
+    // Each sample's slot entries are read before they are rewritten
+    #pragma HLS DEPENDENCE variable=hist_re inter false
+    #pragma HLS DEPENDENCE variable=hist_im inter false
+    static ap_uint<3> wp[FFT_CHANNELS];
+    #pragma HLS ARRAY_PARTITION variable=wp complete
+
+    // M products of DataT x Q2.14, summed without overflow
+    typedef ap_fixed<DataT::width + 16 + 3, DataT::iwidth + 2 + 3> acc_t;
+    const int addr = chan * N + n;
+    const int w    = wp[chan];
+    DataT old_re[S], old_im[S];
+    #pragma HLS ARRAY_PARTITION variable=old_re complete
+    #pragma HLS ARRAY_PARTITION variable=old_im complete
+    PFB_SLOT_LOOP: for (int k = 0; k < S; k++) {
+        #pragma HLS UNROLL
+        old_re[k] = hist_re[k][addr];
+        old_im[k] = hist_im[k][addr];
+        if (k == w) {
+            hist_re[k][addr] = xr;
+            hist_im[k][addr] = xi;
+        }
+    }
+    acc_t acc_re = (acc_t)(xr * h[S][n]);
+    acc_t acc_im = (acc_t)(xi * h[S][n]);
+    PFB_TAP_LOOP: for (int j = 0; j < S; j++) {
+        #pragma HLS UNROLL
+        const int k = (w + j < S) ? w + j : w + j - S;   // slot of block t - S + j
+        acc_re += old_re[k] * h[j][n];
+        acc_im += old_im[k] * h[j][n];
+    }
+    if (frame_end) wp[chan] = (w == S - 1) ? 0 : w + 1;
+    if (ctrl & FFT_CTRL_PFB) {
+        xr = (DataT)acc_re;
+        xi = (DataT)acc_im;
+    }
+}
+#endif
+
+/* ================================================================
+ *  Block Floating Point (FFT_BFP)
+ *
+ *  Each butterfly pass receives a token holding the OR of the magnitude
+ *  bit patterns of its input frame and the exponent so far. The highest
+ *  set bit bounds the frame peak, so the pass pre-scales its operands by
+ *  2^-s with s just large enough that the pass growth (< 2^GUARD) stays
+ *  inside DataT, and hands on the OR of its own outputs.
+ * ================================================================ */
+
+template <typename DataT>
+struct bfp_token {
+    ap_uint<DataT::width> norm;   // OR of |x| bit patterns over the frame
+    bfp_exp_t             exp;    // right shifts applied so far
+};
+
+/**
+ * @brief Magnitude bit pattern of x (one's complement for negative values)
+ */
+template <typename DataT>
+static ap_uint<DataT::width> bfp_mag(DataT x) {
+    #pragma HLS INLINE
+    ap_uint<DataT::width> bits = x.range();
+    return bits[DataT::width - 1] ? (ap_uint<DataT::width>)~bits : bits;
+}
+
+/**
+ * @brief Pre-scale shift s = 0 .. GUARD for a pass with growth below 2^GUARD
+ *
+ * s is the number of the GUARD bits below the sign that the frame
+ * peak reaches into.
+ */
+template <typename DataT, int GUARD>
+static ap_uint<2> bfp_shift(ap_uint<DataT::width> norm) {
+    #pragma HLS INLINE
+    ap_uint<2> sh = 0;
+    BFP_SHIFT_LOOP: for (int i = GUARD - 1; i >= 0; i--) {
+        #pragma HLS UNROLL
+        if (norm[DataT::width - 2 - i]) sh = GUARD - i;
+    }
+    return sh;
+}
+
+/* ================================================================
+ *  Performance Counters (FFT_PERF)
+ *
+ *  read_input and write_output poll their stream instead of blocking:
+ *  a cycle on which the next beat cannot move is counted as a stall and
+ *  the beat retried, so both loops keep II=1 and only stretch by the
+ *  stall count. The butterfly processes count butterflies whose sum or
+ *  difference wrapped. Each process also counts the iterations of its
+ *  II=1 loops, stalls included: read_input and write_output their stream
+ *  loop, the processes in between their butterfly (or filter) loops, of
+ *  which the token keeps the longest. In DATAFLOW the slowest process
+ *  sets the frame interval; with FFT_INPLACE they run one after another.
+ *  The per-frame counts travel with the frame in a perf_token, like the
+ *  BFP token, and write_output adds them to the totals it publishes in
+ *  the perf registers.
+ * ================================================================ */
+
+/**
+ * @brief Event counts of one frame, passed along the DATAFLOW chain
+ */
+struct perf_token {
+    fft_perf_t in_stall;      // read_input cycles without an input beat
+    fft_perf_t in_cycles;     // read_input loop cycles
+    fft_perf_t bfly_cycles;   // loop cycles of the longest process after read_input
+    fft_perf_t overflow;      // butterflies that wrapped so far
+};
+
+/**
+ * @brief Record a process's loop cycles in the token if it is the longest so far
+ */
+static inline void perf_bfly(perf_token &ptok, fft_perf_t cycles) {
+    if (cycles > ptok.bfly_cycles) ptok.bfly_cycles = cycles;
+}
+
+/**
+ * @brief True if x + y (sub: x - y) wrapped to result r
+ *
+ * Two's complement wraps exactly when both operands of the addition have
+ * the same sign and the result has the other one.
+ */
+template <typename DataT>
+static bool add_wrapped(DataT x, DataT y, DataT r, bool sub) {
+    #pragma HLS INLINE
+    bool sx = x < 0;
+    bool sy = sub ? !(y < 0) && y != 0 : y < 0;
+    return sx == sy && (r < 0) != sx;
+}
+
+/**
+ * @brief True if either output s = x + y, d = x - y of a butterfly wrapped
+ */
+template <typename DataT>
+static bool butterfly_wrapped(DataT xr, DataT xi, DataT yr, DataT yi,
+                              DataT sr, DataT si, DataT dr, DataT di) {
+    #pragma HLS INLINE
+    return add_wrapped(xr, yr, sr, false) | add_wrapped(xi, yi, si, false)
+         | add_wrapped(xr, yr, dr, true)  | add_wrapped(xi, yi, di, true);
+}
+
+/* ================================================================
+ *  Memory-Based Engines (DATAFLOW tasks)
+ * ================================================================ */
+
+// Banks of the in-place memory engine's frame buffers: one per butterfly
+// operand, so every bank sees at most one read and one write per clock
+#if FFT_ENGINE == FFT_ENGINE_MEMORY
+#define FFT_MEM_BANKS FFT_RADIX
+#else
+#define FFT_MEM_BANKS 1
+#endif
+
+/**
+ * @brief Physical position of sample idx in a BANKS-way banked frame buffer
+ *
+ * Bank = XOR of the log2(BANKS)-bit digits of idx, address = idx / BANKS,
+ * laid out bank-major so ARRAY_PARTITION block factor=BANKS splits the
+ * buffer along the banks. The operands of a radix-2 (radix-4) butterfly
+ * differ in one (two adjacent) index bits, which always moves them to
+ * distinct banks, at every stage.
+ */
+template <int N, int BANKS>
+static ap_uint<fft_log2(N)> mem_phys(ap_uint<fft_log2(N)> idx) {
+    #pragma HLS INLINE
+    const int LB = fft_log2(BANKS);
+    if (BANKS == 1) return idx;
+    int bank = 0;
+    MEM_BANK_LOOP: for (int d = 0; d < fft_log2(N); d += (LB > 0 ? LB : 1)) {
+        #pragma HLS UNROLL
+        bank ^= (int)(idx >> d) & (BANKS - 1);
+    }
+    return (ap_uint<fft_log2(N)>)((bank << (fft_log2(N) - LB)) | (int)(idx >> LB));
+}
+
+/**
+ * @brief Read 2^log2_len complex samples from AXI-Stream into bit-reversed slots
+ *
+ * In DIT FFT, input is rearranged so that element at position i
+ * is stored at position bit_rev(i) before the butterfly stages. Writing
+ * each sample straight to its reversed address as it arrives replaces a
+ * separate permutation pass and its PIPO buffer pair.
+ * Shorter frames reverse only their low log2_len index bits. Inverse
+ * frames are conjugated and windowed frames weighted here, as the samples
+ * arrive. FFT_CTRL_BITREV_IN frames are already in bit-reversed order and
+ * are stored at their arrival index. With FFT_STFT only the last hop_beats
+ * samples are read from the stream (stft_read); they are read first, so
+ * their TID selects the channel before its history is read. The channel
+ * goes to write_output as a token (FFT_CHANNELS > 1). With FFT_PFB_TAPS
+ * each sample passes pfb_filter, after the branch memories are reloaded
+ * when pfb_load is set.
+ */
+template <int N, int BANKS, typename DataT>
+static void read_input(hls::stream<axis_t> &in_stream,
+                       DataT real_buf[N], DataT imag_buf[N], log2_len_t log2_len,
+                       fft_ctrl_t ctrl, int hop_beats FFT_WIN_PARAM(N)
+#if FFT_PFB_TAPS
+                       , const pfb_word_t pfb_coef[FFT_PFB_TAPS * N / 2], bool pfb_load
+#endif
+#if FFT_CHANNELS > 1
+                       , hls::stream<fft_chan_t> &chan_out
+#endif
+#if FFT_PERF
+                       , hls::stream<perf_token> &perf_out
+#endif
+#if FFT_BFP
+                       , hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+                       ) {
+#if FFT_BFP
+    ap_uint<DataT::width> norm = 0;
+#endif
+    const int len = 1 << log2_len;
+    fft_chan_t chan = 0;
+#if FFT_PFB_TAPS
+    // Prototype branches, one memory each
+    static pfb_coef_t pfb_h[FFT_PFB_TAPS][N];
+    #pragma HLS ARRAY_PARTITION variable=pfb_h complete dim=1
+    if (pfb_load) pfb_load_branches<N>(pfb_h, pfb_coef);
+#endif
+#if FFT_PERF
+    fft_perf_t in_stall = 0;
+    int j = 0;
+    READ_LOOP: while (j < len) {
+#else
+    READ_LOOP: for (int j = 0; j < len; j++) {
+#endif
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=N
+#if FFT_STFT
+        // New samples first, then the reused ones from the history
+        int i = (j < hop_beats) ? j + len - hop_beats : j - hop_beats;
+#else
+        int i = j;
+#endif
+#if FFT_PERF
+        if (i >= len - hop_beats && in_stream.empty()) {
+            in_stall++;
+            continue;
+        }
+#endif
+        beat_t data = stft_read<N>(in_stream, i, len, hop_beats, j == len - 1, chan);
+        fixed_t re, im;
+        unpack_data(data, re, im);
+        DataT xr = re;
+        DataT xi = inverse_input<DataT>(im, ctrl);
+#if FFT_PFB_TAPS
+        pfb_filter<N, DataT>(xr, xi, i, j == len - 1, chan, ctrl, pfb_h);
+#endif
+        window_input<N, DataT>(xr, xi, i, log2_len, ctrl FFT_WIN_ARG);
+        ap_uint<fft_log2(N)> rev = (ctrl & FFT_CTRL_BITREV_IN)
+                                 ? (ap_uint<fft_log2(N)>)i
+                                 : (ap_uint<fft_log2(N)>)(bit_reverse_idx<fft_log2(N)>(i) >> (fft_log2(N) - log2_len));
+        real_buf[mem_phys<N, BANKS>(rev)] = xr;
+        imag_buf[mem_phys<N, BANKS>(rev)] = xi;
+#if FFT_BFP
+        norm |= bfp_mag<DataT>(xr) | bfp_mag<DataT>(xi);
+#endif
+#if FFT_PERF
+        j++;
+#endif
+    }
+#if FFT_CHANNELS > 1
+    chan_out.write(chan);
+#endif
+#if FFT_PERF
+    perf_token ptok;
+    ptok.in_stall    = in_stall;
+    ptok.in_cycles   = (fft_perf_t)len + in_stall;   // READ_LOOP iterations
+    ptok.bfly_cycles = 0;
+    ptok.overflow    = 0;
+    perf_out.write(ptok);
+#endif
+#if FFT_BFP
+    bfp_token<DataT> tok;
+    tok.norm = norm;
+    tok.exp  = 0;
+    bfp_out.write(tok);
+#endif
+}
+
+/**
+ * @brief Perform the log2_len butterfly stages of the Radix-2 DIT FFT
+ *
+ * Uses the compile-time twiddle ROM for size N. Stage s needs
+ * W_(2^(s+1))^j = W_N^(j * N / 2^(s+1)) whatever the active length, so
+ * shorter frames just run fewer stages of fewer butterflies each.
+ *
+ * Stage 0 reads the input PIPO buffer and fills the output PIPO buffer;
+ * all later stages work in place on the output buffer, which the write
+ * process then drains directly, so no working copy is needed. With
+ * FFT_INPLACE both are the same buffer and stage 0 reads it too.
+ *
+ * Both buffers are banked (mem_phys), so the two operand reads and two
+ * result writes of a butterfly hit different banks and the loop sustains
+ * II=1. Stages are not flattened: each drains before the next starts, so
+ * within a stage no address is read after it is written and the
+ * DEPENDENCE pragmas state a fact rather than hide a hazard.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void fft_stages(DataT in_real[N], DataT in_imag[N],
+                       DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                       , hls::stream<bfp_token<DataT> > &bfp_in,
+                       hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                       , hls::stream<perf_token> &perf_in,
+                       hls::stream<perf_token> &perf_out
+#endif
+                       ) {
+#if FFT_BFP
+    bfp_token<DataT> tok = bfp_in.read();
+#endif
+#if FFT_PERF
+    perf_token ptok = perf_in.read();
+    fft_perf_t ovf  = ptok.overflow;
+    perf_bfly(ptok, (fft_perf_t)(log2_len * (1 << (log2_len - 1))));   // BUTTERFLY_LOOP iterations
+#endif
+
+    // Process log2_len butterfly stages
+    STAGE_LOOP: for (int stage = 0; stage < log2_len; stage++) {
+        #pragma HLS LOOP_TRIPCOUNT min=4 max=fft_log2(N)
+        #pragma HLS LOOP_FLATTEN off
+        int half      = 1 << stage;          // butterflies per group
+        int tw_stride = N >> (stage + 1);    // twiddle index stride
+#if FFT_BFP
+        ap_uint<2> sh = bfp_shift<DataT, 2>(tok.norm);
+        ap_uint<DataT::width> norm = 0;
+#endif
+
+        BUTTERFLY_LOOP: for (int k = 0; k < (1 << (log2_len - 1)); k++) {
+            #pragma HLS PIPELINE II=1
+            #pragma HLS LOOP_TRIPCOUNT min=8 max=N/2
+            #pragma HLS DEPENDENCE variable=out_real inter false
+            #pragma HLS DEPENDENCE variable=out_imag inter false
+
+            // Compute indices
+            int j       = k & (half - 1);                  // position within group
+            int group   = (k >> stage) << (stage + 1);     // group start index
+            int idx_top = group + j;
+            int idx_bot = group + j + half;
+            int tw_idx  = j * tw_stride;
+            ap_uint<fft_log2(N)> pos_top = mem_phys<N, FFT_MEM_BANKS>(idx_top);
+            ap_uint<fft_log2(N)> pos_bot = mem_phys<N, FFT_MEM_BANKS>(idx_bot);
+
+            // Load twiddle factor from ROM
+            twiddle_pt<TwiddleT> tw = twiddle_at<N, TwiddleT>(tw_idx);
+
+            // Load butterfly operands (stage 0 from the input buffer)
+            bool  first = !FFT_INPLACE && stage == 0;
+            DataT ar = first ? in_real[pos_top] : out_real[pos_top];
+            DataT ai = first ? in_imag[pos_top] : out_imag[pos_top];
+            DataT br = first ? in_real[pos_bot] : out_real[pos_bot];
+            DataT bi = first ? in_imag[pos_bot] : out_imag[pos_bot];
+#if FFT_BFP
+            ar >>= sh;  ai >>= sh;
+            br >>= sh;  bi >>= sh;
+#endif
+
+            // Complex multiply: (br + j*bi) * (tw_r + j*tw_i)
+            DataT tr, ti;
+            complex_mul(br, bi, tw, tr, ti);
+
+            // Butterfly output
+            DataT yr0 = ar + tr, yi0 = ai + ti;
+            DataT yr1 = ar - tr, yi1 = ai - ti;
+            out_real[pos_top] = yr0;
+            out_imag[pos_top] = yi0;
+            out_real[pos_bot] = yr1;
+            out_imag[pos_bot] = yi1;
+#if FFT_BFP
+            norm |= bfp_mag(yr0) | bfp_mag(yi0) | bfp_mag(yr1) | bfp_mag(yi1);
+#endif
+#if FFT_PERF
+            if (butterfly_wrapped(ar, ai, tr, ti, yr0, yi0, yr1, yi1)) ovf++;
+#endif
+        }
+#if FFT_BFP
+        tok.norm = norm;
+        tok.exp += sh;
+#endif
+    }
+#if FFT_BFP
+    bfp_out.write(tok);
+#endif
+#if FFT_PERF
+    ptok.overflow = ovf;
+    perf_out.write(ptok);
+#endif
+}
+
+/**
+ * @brief Radix-4 butterfly passes over the bit-reversed buffer (FFT_RADIX == 4)
+ *
+ * Each pass merges radix-2 stages s and s+1 (h = 2^s, W = W_(4h)): with
+ * operands a, b, c, d at offsets 0, h, 2h, 3h the two stages reduce to
+ *   B = b*W^(2j), C = c*W^j, D = d*W^(3j)
+ *   a' = (a + B) + (C + D),     c' = (a + B) - (C + D)
+ *   b' = (a - B) - j*(C - D),   d' = (a - B) + j*(C - D)
+ * so three twiddle multiplies replace four and the W_4 factor is a swap.
+ * Odd log2_len starts with one radix-2 stage, whose twiddles are all W^0.
+ * As in fft_stages, the first pass reads the input buffer (unless
+ * FFT_INPLACE) and the rest run in place on the output buffer; with four
+ * banks the four operands of every pass land in different banks.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void fft_stages_r4(DataT in_real[N], DataT in_imag[N],
+                          DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                          , hls::stream<bfp_token<DataT> > &bfp_in,
+                          hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                          , hls::stream<perf_token> &perf_in,
+                          hls::stream<perf_token> &perf_out
+#endif
+                          ) {
+    bool odd    = log2_len[0];
+    int  passes = (log2_len + 1) >> 1;
+#if FFT_BFP
+    bfp_token<DataT> tok = bfp_in.read();
+#endif
+#if FFT_PERF
+    perf_token ptok = perf_in.read();
+    fft_perf_t ovf  = ptok.overflow;
+    perf_bfly(ptok, (fft_perf_t)(passes * (1 << (log2_len - 2))));     // R4_BF_LOOP iterations
+#endif
+
+    R4_PASS_LOOP: for (int p = 0; p < passes; p++) {
+        #pragma HLS LOOP_TRIPCOUNT min=2 max=(fft_log2(N)+1)/2
+        #pragma HLS LOOP_FLATTEN off
+        bool r2     = odd && (p == 0);         // leading radix-2 stage
+        int  log2_h = odd ? 2 * p - 1 : 2 * p; // first merged stage
+        int  h      = 1 << log2_h;
+#if FFT_BFP
+        ap_uint<2> sh = bfp_shift<DataT, 3>(tok.norm);
+        ap_uint<DataT::width> norm = 0;
+#endif
+
+        R4_BF_LOOP: for (int k = 0; k < (1 << (log2_len - 2)); k++) {
+            #pragma HLS PIPELINE II=1
+            #pragma HLS LOOP_TRIPCOUNT min=4 max=N/4
+            #pragma HLS DEPENDENCE variable=out_real inter false
+            #pragma HLS DEPENDENCE variable=out_imag inter false
+
+            // Operand indices: 4 consecutive samples for the radix-2 stage
+            int j = 0, ia, step;
+            if (r2) {
+                ia   = 4 * k;
+                step = 1;
+            } else {
+                j    = k & (h - 1);
+                ia   = ((k >> log2_h) << (log2_h + 2)) + j;
+                step = h;
+            }
+            int ib = ia + step, ic = ib + step, id = ic + step;
+            ap_uint<fft_log2(N)> pa = mem_phys<N, FFT_MEM_BANKS>(ia);
+            ap_uint<fft_log2(N)> pb = mem_phys<N, FFT_MEM_BANKS>(ib);
+            ap_uint<fft_log2(N)> pc = mem_phys<N, FFT_MEM_BANKS>(ic);
+            ap_uint<fft_log2(N)> pd = mem_phys<N, FFT_MEM_BANKS>(id);
+
+            bool  first = !FFT_INPLACE && p == 0;
+            DataT ar = first ? in_real[pa] : out_real[pa];
+            DataT ai = first ? in_imag[pa] : out_imag[pa];
+            DataT br = first ? in_real[pb] : out_real[pb];
+            DataT bi = first ? in_imag[pb] : out_imag[pb];
+            DataT cr = first ? in_real[pc] : out_real[pc];
+            DataT ci = first ? in_imag[pc] : out_imag[pc];
+            DataT dr = first ? in_real[pd] : out_real[pd];
+            DataT di = first ? in_imag[pd] : out_imag[pd];
+#if FFT_BFP
+            ar >>= sh;  ai >>= sh;
+            br >>= sh;  bi >>= sh;
+            cr >>= sh;  ci >>= sh;
+            dr >>= sh;  di >>= sh;
+#endif
+
+            DataT yar, yai, ybr, ybi, ycr, yci, ydr, ydi;
+            bool wrapped = false;
+            if (r2) {
+                // Two radix-2 butterflies (a, b) and (c, d), twiddle W^0
+                yar = ar + br;  yai = ai + bi;
+                ybr = ar - br;  ybi = ai - bi;
+                ycr = cr + dr;  yci = ci + di;
+                ydr = cr - dr;  ydi = ci - di;
+                wrapped = butterfly_wrapped(ar, ai, br, bi, yar, yai, ybr, ybi)
+                        | butterfly_wrapped(cr, ci, dr, di, ycr, yci, ydr, ydi);
+            } else {
+                // W_(4h)^j = W_N^(j * N / 4h)
+                ap_uint<fft_log2(N)> e = j << (fft_log2(N) - 2 - log2_h);
+                twiddle_pt<TwiddleT> w1 = twiddle_full<N, TwiddleT>(e);
+                twiddle_pt<TwiddleT> w2 = twiddle_full<N, TwiddleT>(2 * e);
+                twiddle_pt<TwiddleT> w3 = twiddle_full<N, TwiddleT>(3 * e);
+
+                DataT Br, Bi, Cr, Ci, Dr, Di;
+                complex_mul(br, bi, w2, Br, Bi);
+                complex_mul(cr, ci, w1, Cr, Ci);
+                complex_mul(dr, di, w3, Dr, Di);
+
+                DataT s0r = ar + Br, s0i = ai + Bi;   // a + B
+                DataT s1r = ar - Br, s1i = ai - Bi;   // a - B
+                DataT s2r = Cr + Dr, s2i = Ci + Di;   // C + D
+                DataT s3r = Cr - Dr, s3i = Ci - Di;   // C - D
+
+                yar = s0r + s2r;  yai = s0i + s2i;
+                ycr = s0r - s2r;  yci = s0i - s2i;
+                ybr = s1r + s3i;  ybi = s1i - s3r;    // (a - B) - j*(C - D)
+                ydr = s1r - s3i;  ydi = s1i + s3r;    // (a - B) + j*(C - D)
+                wrapped = butterfly_wrapped(ar, ai, Br, Bi, s0r, s0i, s1r, s1i)
+                        | butterfly_wrapped(Cr, Ci, Dr, Di, s2r, s2i, s3r, s3i)
+                        | butterfly_wrapped(s0r, s0i, s2r, s2i, yar, yai, ycr, yci)
+                        | butterfly_wrapped(s1r, s1i, s3i, (DataT)-s3r, ybr, ybi, ydr, ydi);
+            }
+#if FFT_PERF
+            if (wrapped) ovf++;
+#else
+            (void)wrapped;
+#endif
+
+            out_real[pa] = yar;  out_imag[pa] = yai;
+            out_real[pb] = ybr;  out_imag[pb] = ybi;
+            out_real[pc] = ycr;  out_imag[pc] = yci;
+            out_real[pd] = ydr;  out_imag[pd] = ydi;
+#if FFT_BFP
+            norm |= bfp_mag(yar) | bfp_mag(yai) | bfp_mag(ybr) | bfp_mag(ybi)
+                  | bfp_mag(ycr) | bfp_mag(yci) | bfp_mag(ydr) | bfp_mag(ydi);
+#endif
+        }
+#if FFT_BFP
+        tok.norm = norm;
+        tok.exp += sh;
+#endif
+    }
+#if FFT_BFP
+    bfp_out.write(tok);
+#endif
+#if FFT_PERF
+    ptok.overflow = ovf;
+    perf_out.write(ptok);
+#endif
+}
+
+/**
+ * @brief One radix-2 DIT stage as its own DATAFLOW process (FFT_ENGINE_STAGED)
+ *
+ * Out-of-place: operands come from the previous stage's PIPO buffer and
+ * results go to this stage's, so the two reads and two writes per
+ * butterfly land on different dual-port memories and the loop runs at
+ * II=1 without dependence overrides. The stage only needs W_(2^(STAGE+1))^j
+ * for j < 2^STAGE, so it gets a private ROM of exactly that slice.
+ * Stages at or beyond log2_len pass the shorter frame through unchanged.
+ */
+template <int N, int STAGE, typename DataT, typename TwiddleT>
+static void fft_stage(DataT in_real[N], DataT in_imag[N],
+                      DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                      , hls::stream<bfp_token<DataT> > &bfp_in,
+                      hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                      , hls::stream<perf_token> &perf_in,
+                      hls::stream<perf_token> &perf_out
+#endif
+                      ) {
+    const int HALF = 1 << STAGE;   // butterflies per group
+    bool active = (STAGE < log2_len);
+#if FFT_BFP
+    bfp_token<DataT> tok = bfp_in.read();
+    ap_uint<2> sh = active ? bfp_shift<DataT, 2>(tok.norm) : (ap_uint<2>)0;
+    ap_uint<DataT::width> norm = 0;
+#endif
+#if FFT_PERF
+    perf_token ptok = perf_in.read();
+    fft_perf_t ovf  = ptok.overflow;
+    perf_bfly(ptok, (fft_perf_t)(1 << (log2_len - 1)));                // STAGE_BF_LOOP iterations
+#endif
+
+    STAGE_BF_LOOP: for (int k = 0; k < (1 << (log2_len - 1)); k++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=8 max=N/2
+        int j       = k & (HALF - 1);
+        int group   = (k >> STAGE) << (STAGE + 1);
+        int idx_top = active ? group + j : 2 * k;
+        int idx_bot = active ? group + j + HALF : 2 * k + 1;
+
+        DataT ar = in_real[idx_top];
+        DataT ai = in_imag[idx_top];
+        DataT br = in_real[idx_bot];
+        DataT bi = in_imag[idx_bot];
+#if FFT_BFP
+        ar >>= sh;  ai >>= sh;
+        br >>= sh;  bi >>= sh;
+#endif
+
+        twiddle_pt<TwiddleT> tw = twiddle_at<2 * HALF, TwiddleT>(j);
+
+        DataT tr, ti;
+        complex_mul(br, bi, tw, tr, ti);
+
+        DataT yr0, yi0, yr1, yi1;
+        if (active) {
+            yr0 = ar + tr;  yi0 = ai + ti;
+            yr1 = ar - tr;  yi1 = ai - ti;
+#if FFT_PERF
+            if (butterfly_wrapped(ar, ai, tr, ti, yr0, yi0, yr1, yi1)) ovf++;
+#endif
+        } else {
+            yr0 = ar;  yi0 = ai;
+            yr1 = br;  yi1 = bi;
+        }
+        out_real[idx_top] = yr0;
+        out_imag[idx_top] = yi0;
+        out_real[idx_bot] = yr1;
+        out_imag[idx_bot] = yi1;
+#if FFT_BFP
+        norm |= bfp_mag(yr0) | bfp_mag(yi0) | bfp_mag(yr1) | bfp_mag(yi1);
+#endif
+    }
+#if FFT_BFP
+    tok.norm = norm;
+    tok.exp += sh;
+    bfp_out.write(tok);
+#endif
+#if FFT_PERF
+    ptok.overflow = ovf;
+    perf_out.write(ptok);
+#endif
+}
+
+/**
+ * @brief Chain of fft_stage processes STAGE .. log2(N)-1
+ *
+ * Inlined into the DATAFLOW region so every stage becomes a separate
+ * process, linked by its own PIPO buffer pair.
+ */
+template <int N, int STAGE, typename DataT, typename TwiddleT,
+          bool LAST = (STAGE == fft_log2(N) - 1)>
+struct staged_chain {
+    static void run(DataT in_real[N], DataT in_imag[N],
+                    DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                    , hls::stream<bfp_token<DataT> > &bfp_in,
+                    hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                    , hls::stream<perf_token> &perf_in,
+                    hls::stream<perf_token> &perf_out
+#endif
+                    ) {
+        #pragma HLS INLINE
+        DataT mid_real[N], mid_imag[N];
+#if FFT_BFP
+        hls::stream<bfp_token<DataT> > bfp_mid("bfp_mid");
+#endif
+#if FFT_PERF
+        hls::stream<perf_token> perf_mid("perf_mid");
+#endif
+        fft_stage<N, STAGE, DataT, TwiddleT>(in_real, in_imag, mid_real, mid_imag, log2_len
+                                             FFT_BFP_IO(bfp_in, bfp_mid)
+                                             FFT_PERF_IO(perf_in, perf_mid));
+        staged_chain<N, STAGE + 1, DataT, TwiddleT>::run(mid_real, mid_imag, out_real, out_imag, log2_len
+                                                        FFT_BFP_IO(bfp_mid, bfp_out)
+                                                        FFT_PERF_IO(perf_mid, perf_out));
+    }
+};
+
+template <int N, int STAGE, typename DataT, typename TwiddleT>
+struct staged_chain<N, STAGE, DataT, TwiddleT, true> {
+    static void run(DataT in_real[N], DataT in_imag[N],
+                    DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                    , hls::stream<bfp_token<DataT> > &bfp_in,
+                    hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                    , hls::stream<perf_token> &perf_in,
+                    hls::stream<perf_token> &perf_out
+#endif
+                    ) {
+        #pragma HLS INLINE
+        fft_stage<N, STAGE, DataT, TwiddleT>(in_real, in_imag, out_real, out_imag, log2_len
+                                             FFT_BFP_IO(bfp_in, bfp_out)
+                                             FFT_PERF_IO(perf_in, perf_out));
+    }
+};
+
+/**
+ * @brief Butterfly passes of the engine selected by FFT_ENGINE and FFT_RADIX
+ *
+ * Inlined, so inside the DATAFLOW region it adds the same processes as a
+ * direct call; fast convolution instantiates it twice.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void fft_butterflies(DataT in_real[N], DataT in_imag[N],
+                            DataT out_real[N], DataT out_imag[N], log2_len_t log2_len
+#if FFT_BFP
+                            , hls::stream<bfp_token<DataT> > &bfp_in,
+                            hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                            , hls::stream<perf_token> &perf_in,
+                            hls::stream<perf_token> &perf_out
+#endif
+                            ) {
+    #pragma HLS INLINE
+#if FFT_ENGINE == FFT_ENGINE_STAGED
+    staged_chain<N, 0, DataT, TwiddleT>::run(in_real, in_imag, out_real, out_imag, log2_len
+                                             FFT_BFP_IO(bfp_in, bfp_out) FFT_PERF_IO(perf_in, perf_out));
+#elif FFT_RADIX == 4
+    fft_stages_r4<N, DataT, TwiddleT>(in_real, in_imag, out_real, out_imag, log2_len
+                                      FFT_BFP_IO(bfp_in, bfp_out) FFT_PERF_IO(perf_in, perf_out));
+#else
+    fft_stages<N, DataT, TwiddleT>(in_real, in_imag, out_real, out_imag, log2_len
+                                   FFT_BFP_IO(bfp_in, bfp_out) FFT_PERF_IO(perf_in, perf_out));
+#endif
+}
+
+/* ================================================================
+ *  Fast Convolution (FFT_FASTCONV)
+ *
+ *  Overlap-save: the STFT history turns the stream into frames of
+ *  fft_len samples that overlap by fft_len - hop. Between a forward and
+ *  a second butterfly pass, filter_multiply forms Y = X * H and stores
+ *  conj(Y) in bit-reversed order, which is what an inverse frame's input
+ *  stage would have written (IFFT(Y) = conj(FFT(conj(Y)))). write_output
+ *  applies the outer conjugate and 1 / fft_len and drops the first
+ *  fft_len - hop samples, which carry the circular wrap.
+ * ================================================================ */
+
+/**
+ * @brief conj(X[k] * H[k]) of a natural-order spectrum, stored bit-reversed
+ *
+ * H[k] is word k of the filter RAM for every active length, so the host
+ * loads the response of the fft_len in use. With FFT_BFP the exponent
+ * passes through and the token carries the peak of the products.
+ */
+template <int N, int BANKS, typename DataT>
+static void filter_multiply(DataT in_real[N], DataT in_imag[N],
+                            DataT out_real[N], DataT out_imag[N], log2_len_t log2_len,
+                            const filter_word_t filter_coef[N]
+#if FFT_BFP
+                            , hls::stream<bfp_token<DataT> > &bfp_in,
+                            hls::stream<bfp_token<DataT> > &bfp_out
+#endif
+#if FFT_PERF
+                            , hls::stream<perf_token> &perf_in,
+                            hls::stream<perf_token> &perf_out
+#endif
+                            ) {
+#if FFT_BFP
+    bfp_token<DataT> tok = bfp_in.read();
+    ap_uint<DataT::width> norm = 0;
+#endif
+#if FFT_PERF
+    perf_token ptok = perf_in.read();
+    perf_bfly(ptok, (fft_perf_t)(1 << log2_len));                      // FILTER_LOOP iterations
+    perf_out.write(ptok);
+#endif
+    FILTER_LOOP: for (int k = 0; k < (1 << log2_len); k++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=N
+        ap_uint<fft_log2(N)> pos = mem_phys<N, BANKS>(k);
+        DataT xr = in_real[pos];
+        DataT xi = in_imag[pos];
+        filter_word_t word = filter_coef[k];
+        filter_t hr, hi;
+        hr.range() = word.range(31, 16);
+        hi.range() = word.range(15, 0);
+        DataT yr = (DataT)(xr * hr) - (DataT)(xi * hi);
+        DataT yi = -((DataT)(xr * hi) + (DataT)(xi * hr));
+        ap_uint<fft_log2(N)> rev = bit_reverse_idx<fft_log2(N)>(k) >> (fft_log2(N) - log2_len);
+        out_real[mem_phys<N, BANKS>(rev)] = yr;
+        out_imag[mem_phys<N, BANKS>(rev)] = yi;
+#if FFT_BFP
+        norm |= bfp_mag(yr) | bfp_mag(yi);
+#endif
+    }
+#if FFT_BFP
+    tok.norm = norm;
+    bfp_out.write(tok);
+#endif
+}
+
+/* ================================================================
+ *  Real-Input Split (FFT_REAL)
+ *
+ *  z[n] = x[2n] + j*x[2n+1] for a 2L-point real frame x gives, with
+ *  Z = FFT_L(z), a = Z[k] and b = Z[(L - k) mod L]:
+ *      X[k] = (a + b*)/2 - j * W_2L^k * (a - b*)/2,   k = 0 .. L-1.
+ *  X[L] = Re Z[0] - Im Z[0] goes into the imaginary half of bin 0.
+ * ================================================================ */
+
+/**
+ * @brief Turn Z[k] (in xr / xi) and Z[L-k] into bin k of the real transform
+ *
+ * e = k * N / L indexes the 2N-point twiddle ROM for any active length L.
+ * With FFT_BFP the split growth is absorbed as one more exponent step.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void real_split(DataT &xr, DataT &xi, DataT br, DataT bi,
+                       ap_uint<fft_log2(N)> e, bool first) {
+    #pragma HLS INLINE
+    const int SH = FFT_BFP ? 1 : 0;
+    DataT er = (DataT)((xr + br) >> 1);   // even part (a + b*)/2
+    DataT ei = (DataT)((xi - bi) >> 1);
+    DataT dr = (DataT)((xi + bi) >> 1);   // odd part -j(a - b*)/2
+    DataT di = (DataT)((br - xr) >> 1);
+    DataT pr, pi;
+    complex_mul<DataT, TwiddleT>(dr, di, twiddle_at<2 * N, TwiddleT>(e), pr, pi);
+    xr = (DataT)((er + pr) >> SH);
+    xi = first ? (DataT)((er - dr) >> SH) : (DataT)((ei + pi) >> SH);
+}
+
+/* ================================================================
+ *  Spectrum Output Formats (FFT_SCALAR_OUT)
+ *
+ *  One scalar per bin: |X|^2 from the exact fixed-point square sum,
+ *  |X| by CORDIC vectoring (shift-and-add plus one gain multiply) and
+ *  dB from the single-precision log of the power. Two consecutive bins
+ *  share a 64-bit lane, so a frame needs half the beats.
+ * ================================================================ */
+
+#if FFT_SCALAR_OUT
+/**
+ * @brief |x + jy| by CORDIC vectoring
+ *
+ * Each iteration rotates (x, y) towards the positive x axis by atan(2^-i);
+ * the magnitude error falls with the square of the residual angle, so 16
+ * iterations leave it far below the float output LSB.
+ */
+template <typename DataT>
+static ap_ufixed<DataT::width + 1, DataT::iwidth + 1> cordic_mag(DataT x, DataT y) {
+    #pragma HLS INLINE
+    typedef ap_fixed<DataT::width + 3, DataT::iwidth + 3> acc_t;   // CORDIC gain 1.65
+    const int ITERS = 16;
+    const ap_ufixed<18, 0> INV_GAIN = 0.6072529350088813;        // prod cos(atan(2^-i))
+    acc_t ax = (x < 0) ? (acc_t)-x : (acc_t)x;
+    acc_t ay = y;
+    CORDIC_LOOP: for (int i = 0; i < ITERS; i++) {
+        #pragma HLS UNROLL
+        acc_t dx = ay >> i;
+        acc_t dy = ax >> i;
+        if (ay < 0) {
+            ax -= dx;
+            ay += dy;
+        } else {
+            ax += dx;
+            ay -= dy;
+        }
+    }
+    return (ap_ufixed<DataT::width + 1, DataT::iwidth + 1>)(ax * INV_GAIN);
+}
+
+/**
+ * @brief Scalar value of bin (re, im) in format fmt, scaled by 2^exp
+ */
+template <typename DataT>
+static float spectrum_scalar(DataT re, DataT im, fft_ctrl_t fmt, int exp) {
+    #pragma HLS INLINE
+    float power = (float)(re * re + im * im);
+    float value;
+    if (fmt == FFT_CTRL_FMT_POWER) {
+        value = hls::ldexp(power, 2 * exp);
+    } else if (fmt == FFT_CTRL_FMT_MAG) {
+        value = hls::ldexp((float)cordic_mag<DataT>(re, im), exp);
+    } else {
+        value = 10.0f * hls::log10(power) + 6.0206f * exp;   // 20 * log10(2) per step
+    }
+    return value;
+}
+#endif
+
+#if FFT_AVG
+/**
+ * @brief Averaged power of a bin in scalar format fmt
+ *
+ * The magnitude of an average is the root of the mean power, so MAG uses
+ * a square root here instead of CORDIC.
+ */
+static float power_format(float power, fft_ctrl_t fmt) {
+    #pragma HLS INLINE
+    float value;
+    if (fmt == FFT_CTRL_FMT_POWER) {
+        value = power;
+    } else if (fmt == FFT_CTRL_FMT_MAG) {
+        value = hls::sqrt(power);
+    } else {
+        value = 10.0f * hls::log10(power);
+    }
+    return value;
+}
+#endif
+
+/* ================================================================
+ *  Peak Detection (FFT_PEAKS)
+ *
+ *  The K strongest bins so far are kept sorted in registers. Each bin
+ *  is compared with all K entries at once: the entries it beats move
+ *  down one place and the bin takes the first of those places, so the
+ *  list follows the output loop at II=1. Vacant entries sit at the end
+ *  and lose to any bin.
+ * ================================================================ */
+
+#if FFT_PEAKS
+/**
+ * @brief Insert bin k with power p into the sorted peak list
+ *
+ * Ties keep the earlier bin first.
+ */
+template <typename PowT, int BITS>
+static void peak_insert(PowT top_pow[FFT_PEAKS], ap_uint<BITS> top_bin[FFT_PEAKS],
+                        bool top_valid[FFT_PEAKS], PowT p, ap_uint<BITS> k) {
+    #pragma HLS INLINE
+    bool wins[FFT_PEAKS];
+    #pragma HLS ARRAY_PARTITION variable=wins complete
+    PEAK_CMP_LOOP: for (int j = 0; j < FFT_PEAKS; j++) {
+        #pragma HLS UNROLL
+        wins[j] = !top_valid[j] || p > top_pow[j];
+    }
+    // From the end, so entry j - 1 is read before it is replaced
+    PEAK_SHIFT_LOOP: for (int j = FFT_PEAKS - 1; j >= 0; j--) {
+        #pragma HLS UNROLL
+        if (j > 0 && wins[j - 1]) {
+            top_pow[j]   = top_pow[j - 1];
+            top_bin[j]   = top_bin[j - 1];
+            top_valid[j] = top_valid[j - 1];
+        } else if (wins[j]) {
+            top_pow[j]   = p;
+            top_bin[j]   = k;
+            top_valid[j] = true;
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Write 2^log2_len complex samples from buffers to AXI-Stream
+ *
+ * Sets TLAST=1 on the last sample of the active length. With FFT_BFP
+ * every beat carries the frame exponent in TUSER, and the 1/length of a
+ * scaled inverse frame is taken from the exponent instead of the data.
+ * With FFT_REAL forward frames pass through real_split, which reads the
+ * mirror bin on the buffer's second port. FFT_CTRL_BITREV_OUT frames read
+ * bin bit_rev(i) for beat i, so the buffer is drained in stored order.
+ * FFT_CTRL_HALF stops after half the samples; scalar formats emit a beat
+ * for every second bin and set TUSER to 0, the exponent being applied.
+ * tlast is cleared on all but the last frame of an FFT_CTRL_BATCH_TLAST batch.
+ * Samples before `first` are not written (the FFT_FASTCONV discard).
+ * With FFT_AVG and avg_frames K > 1, scalar frames add |X|^2 to a power
+ * accumulator that persists across frames and calls; only the K-th frame
+ * of each block is written, as the block mean or the exponential average
+ * acc += (|X|^2 - acc) / K (FFT_CTRL_AVG_EXP, seeded by its first frame).
+ * The accumulator and block count are per channel; every beat is tagged
+ * with the frame's channel from read_input. A batch TLAST due on a frame
+ * that is not emitted goes out on a null beat (TKEEP = 0) instead.
+ * With FFT_PEAKS, FFT_CTRL_PEAKS frames write no bins: every bin with
+ * |X|^2 >= peak_thresh goes through peak_insert, and the FFT_PEAKS records
+ * follow the loop, TLAST on the last.
+ * With FFT_PERF the loop polls out_stream, counting back-pressure cycles,
+ * and the counter totals and the frame's process cycles are published in
+ * perf after every frame (perf_clear zeroes the totals first).
+ */
+template <int N, int BANKS, typename DataT, typename TwiddleT>
+static void write_output(DataT real_buf[N], DataT imag_buf[N],
+                         hls::stream<axis_t> &out_stream, log2_len_t log2_len,
+                         fft_ctrl_t ctrl, bool tlast, int first, fft_frames_t avg_frames FFT_PEAK_PARAM
+#if FFT_CHANNELS > 1
+                         , hls::stream<fft_chan_t> &chan_in
+#endif
+#if FFT_PERF
+                         , fft_perf_t perf[FFT_PERF_REGS], bool perf_clear,
+                         hls::stream<perf_token> &perf_in
+#endif
+#if FFT_BFP
+                         , hls::stream<bfp_token<DataT> > &bfp_in
+#endif
+                         ) {
+#if FFT_CHANNELS > 1
+    const fft_chan_t chan = chan_in.read();
+#else
+    const fft_chan_t chan = 0;
+#endif
+#if FFT_BFP
+    bfp_exp_t exp = bfp_in.read().exp;
+    if ((ctrl & FFT_CTRL_INVERSE) && (ctrl & FFT_CTRL_SCALE)) exp -= log2_len;
+    if (FFT_REAL && !(ctrl & FFT_CTRL_INVERSE)) exp += 1;
+    const fft_ctrl_t data_ctrl = ctrl & ~FFT_CTRL_SCALE;
+#else
+    const fft_ctrl_t data_ctrl = ctrl;
+#endif
+#if FFT_SCALAR_OUT
+    const fft_ctrl_t fmt = ctrl & FFT_CTRL_FORMAT;
+    float pend = 0.0f;   // scalar of the previous (even) bin
+#endif
+#if FFT_AVG
+    static float        avg_acc[FFT_CHANNELS * N];   // power sum or exponential average per bin
+    static fft_frames_t avg_count[FFT_CHANNELS];     // frames in avg_acc of the current block
+    static bool         avg_seeded[FFT_CHANNELS];
+    const bool  avg_on    = avg_frames > 1 && fmt != FFT_CTRL_FMT_COMPLEX;
+    const bool  avg_exp   = avg_on && (ctrl & FFT_CTRL_AVG_EXP);
+    const bool  avg_first = avg_count[chan] == 0;
+    const bool  avg_emit  = !avg_on || avg_count[chan] >= avg_frames - 1;
+    const bool  seeded    = avg_seeded[chan];
+    const float avg_inv   = 1.0f / (float)avg_frames;
+#else
+    (void)avg_frames;
+#endif
+#if FFT_PEAKS
+    typedef ap_ufixed<2 * DataT::width, 2 * DataT::iwidth> peak_pow_t;   // exact |X|^2
+    const bool peaks = ctrl & FFT_CTRL_PEAKS;
+    peak_pow_t           top_pow[FFT_PEAKS];
+    ap_uint<fft_log2(N)> top_bin[FFT_PEAKS];
+    bool                 top_valid[FFT_PEAKS];
+    #pragma HLS ARRAY_PARTITION variable=top_pow complete
+    #pragma HLS ARRAY_PARTITION variable=top_bin complete
+    #pragma HLS ARRAY_PARTITION variable=top_valid complete
+    PEAK_INIT_LOOP: for (int j = 0; j < FFT_PEAKS; j++) {
+        #pragma HLS UNROLL
+        top_pow[j]   = 0;
+        top_bin[j]   = 0;
+        top_valid[j] = false;
+    }
+#if FFT_BFP
+    const int peak_exp = exp;
+#else
+    const int peak_exp = 0;
+#endif
+    // Threshold in the frame's data scale, saturated to the power range
+    const peak_pow_t peak_thr = (ap_ufixed<2 * DataT::width, 2 * DataT::iwidth, AP_TRN, AP_SAT>)
+                                hls::ldexp((float)peak_thresh, -2 * peak_exp);
+#endif
+    const int n_out = (ctrl & FFT_CTRL_HALF) ? (1 << log2_len) >> 1 : (1 << log2_len);
+#if FFT_PERF
+    const perf_token ptok = perf_in.read();
+    fft_perf_t cycles = 0, out_stall = 0;
+    int i = first;
+    WRITE_LOOP: while (i < n_out) {
+#else
+    WRITE_LOOP: for (int i = first; i < n_out; i++) {
+#endif
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=8 max=N
+#if FFT_AVG
+        // Bins are distinct within a frame; a bin recurs n_out iterations later
+        #pragma HLS DEPENDENCE variable=avg_acc inter false
+#endif
+        axis_t val;
+        bool emit = true;
+#if FFT_SCALAR_OUT
+        if (fmt != FFT_CTRL_FMT_COMPLEX) emit = (i & 1);   // a beat per pair of bins
+#endif
+#if FFT_AVG
+        emit = emit && avg_emit;
+#endif
+#if FFT_PEAKS
+        emit = emit && !peaks;
+#endif
+#if FFT_PERF
+        cycles++;
+        if (emit && out_stream.full()) {
+            out_stall++;
+            continue;
+        }
+#endif
+        ap_uint<fft_log2(N)> k = (ctrl & FFT_CTRL_BITREV_OUT)
+                               ? (ap_uint<fft_log2(N)>)(bit_reverse_idx<fft_log2(N)>(i) >> (fft_log2(N) - log2_len))
+                               : (ap_uint<fft_log2(N)>)i;
+        ap_uint<fft_log2(N)> pos = mem_phys<N, BANKS>(k);
+        DataT yr = real_buf[pos];
+        DataT yi = imag_buf[pos];
+#if FFT_REAL
+        if (!(ctrl & FFT_CTRL_INVERSE)) {
+            ap_uint<fft_log2(N)> mirror = ((1 << log2_len) - k) & ((1 << log2_len) - 1);
+            ap_uint<fft_log2(N)> pos_m  = mem_phys<N, BANKS>(mirror);
+            ap_uint<fft_log2(N)> e      = k << (fft_log2(N) - log2_len);
+            real_split<N, DataT, TwiddleT>(yr, yi, real_buf[pos_m], imag_buf[pos_m], e, k == 0);
+        }
+#endif
+        inverse_output<DataT>(yr, yi, data_ctrl, log2_len);
+#if FFT_PEAKS
+        if (peaks) {
+            // Real-mode bin 0 carries Nyquist in its imaginary half: keep DC only
+            DataT pi = (FFT_REAL && !(ctrl & FFT_CTRL_INVERSE) && k == 0) ? (DataT)0 : yi;
+            peak_pow_t p = yr * yr + pi * pi;
+            if (p >= peak_thr) peak_insert<peak_pow_t, fft_log2(N)>(top_pow, top_bin, top_valid, p, k);
+        }
+#endif
+        val.data = pack_data((fixed_t)yr, (fixed_t)yi);
+#if FFT_BFP
+        val.user = exp;
+#endif
+#if FFT_SCALAR_OUT
+        if (fmt != FFT_CTRL_FMT_COMPLEX) {
+#if FFT_BFP
+            const int scale_exp = exp;
+            val.user = 0;
+#else
+            const int scale_exp = 0;
+#endif
+            // Real-mode bin 0 carries Nyquist in its imaginary half: keep DC only
+            bool dc_only = FFT_REAL && !(ctrl & FFT_CTRL_INVERSE) && k == 0;
+            float v = spectrum_scalar<DataT>(yr, dc_only ? (DataT)0 : yi, fmt, scale_exp);
+#if FFT_AVG
+            if (avg_on) {
+                float p = spectrum_scalar<DataT>(yr, dc_only ? (DataT)0 : yi, FFT_CTRL_FMT_POWER, scale_exp);
+                float acc;
+                const int a = chan * N + k;
+                if (avg_exp) {
+                    acc = seeded ? avg_acc[a] + (p - avg_acc[a]) * avg_inv : p;
+                } else {
+                    acc = avg_first ? p : avg_acc[a] + p;
+                }
+                avg_acc[a] = acc;
+                v = power_format(avg_exp ? acc : acc * avg_inv, fmt);
+            }
+#endif
+            pack_scalars(val.data, 0, pend, v);
+            pend = v;
+        }
+#endif
+        val.keep = -1;   // all bytes valid
+        val.strb = -1;
+        val.last = (tlast && i == n_out - 1) ? 1 : 0;
+        axis_set_chan(val, chan);
+        if (emit) out_stream.write(val);
+#if FFT_PERF
+        i++;
+#endif
+    }
+#if FFT_PEAKS
+    if (peaks) {
+        // Strongest first, vacant records last; TUSER 0, the exponent being applied
+        PEAK_OUT_LOOP: for (int j = 0; j < FFT_PEAKS; j++) {
+            #pragma HLS PIPELINE II=1
+            axis_t val;
+            float power = top_valid[j] ? hls::ldexp((float)top_pow[j], 2 * peak_exp) : 0.0f;
+            val.data = pack_peak(power, top_valid[j] ? (ap_uint<32>)top_bin[j] : (ap_uint<32>)FFT_PEAK_NONE);
+#if FFT_BFP
+            val.user = 0;
+#endif
+            val.keep = -1;
+            val.strb = -1;
+            val.last = (tlast && j == FFT_PEAKS - 1) ? 1 : 0;
+            axis_set_chan(val, chan);
+            out_stream.write(val);
+        }
+    }
+#endif
+#if FFT_AVG
+    if (tlast && !avg_emit && (ctrl & FFT_CTRL_BATCH_TLAST)) {
+        // The batch ends inside a block: a null beat (TKEEP = 0) carries its TLAST
+        axis_t val;
+        val.data = 0;
+#if FFT_BFP
+        val.user = 0;
+#endif
+        val.keep = 0;
+        val.strb = 0;
+        val.last = 1;
+        axis_set_chan(val, chan);
+        out_stream.write(val);
+    }
+    avg_count[chan]  = avg_emit ? (fft_frames_t)0 : (fft_frames_t)(avg_count[chan] + 1);
+    avg_seeded[chan] = avg_exp;
+#endif
+#if FFT_PERF
+    static fft_perf_t in_stall_total, out_stall_total, frames_total, overflow_total;
+    if (perf_clear) {
+        in_stall_total = out_stall_total = frames_total = overflow_total = 0;
+    }
+    in_stall_total  += ptok.in_stall;
+    out_stall_total += out_stall;
+    overflow_total  += ptok.overflow;
+    frames_total++;
+#if FFT_INPLACE
+    // Sequential loop body: the processes run in turn
+    const fft_perf_t frame = ptok.in_cycles + ptok.bfly_cycles + cycles;
+#else
+    // DATAFLOW: the slowest process sets the frame interval
+    fft_perf_t frame = ptok.in_cycles;
+    if (ptok.bfly_cycles > frame) frame = ptok.bfly_cycles;
+    if (cycles > frame) frame = cycles;
+#endif
+    perf[FFT_PERF_CYCLES]      = frame;
+    perf[FFT_PERF_IN_STALL]    = in_stall_total;
+    perf[FFT_PERF_OUT_STALL]   = out_stall_total;
+    perf[FFT_PERF_FRAMES]      = frames_total;
+    perf[FFT_PERF_OVERFLOW]    = overflow_total;
+    perf[FFT_PERF_IN_CYCLES]   = ptok.in_cycles;
+    perf[FFT_PERF_BFLY_CYCLES] = ptok.bfly_cycles;
+    perf[FFT_PERF_OUT_CYCLES]  = cycles;
+#endif
+}
+
+/* ================================================================
+ *  Streaming R2^2 SDF Engine (FFT_ENGINE == FFT_ENGINE_SDF)
+ *
+ *  Radix-2^2 decimation-in-frequency pipeline with one butterfly per
+ *  stage and a feedback delay line of D = L >> (stage + 1) samples for
+ *  an L-point lane. Stages are paired (BF2I / BF2II): inside a pair only
+ *  a trivial -j rotation is needed, and a single complex multiplier sits
+ *  after each pair, giving 3 twiddle multipliers instead of 7 at L = 256.
+ *
+ *  With FFT_SSR lanes per beat, lane l carries x[l + FFT_SSR * m]. Each
+ *  lane runs its own L = N / FFT_SSR point SDF pipeline; the lane results
+ *  are rotated by W_N^(l * k1) and combined by an FFT_SSR-point butterfly
+ *  network (N = FFT_SSR x L Cooley-Tukey split). With FFT_SSR = 1 this
+ *  reduces to the plain single-lane pipeline.
+ *
+ *  Results leave the stage chain in bit-reversed order and are put
+ *  back in natural order by a ping-pong reorder buffer. All state is
+ *  static, so consecutive fft() calls form one continuous stream.
+ * ================================================================ */
+
+/**
+ * @brief One SDF butterfly stage of an L = 2^LOG2_L point lane pipeline
+ *
+ * Even stages are BF2I (plain radix-2 butterfly). Odd stages are BF2II:
+ * the lower operand is rotated by -j in the lower half of each pair
+ * block, and the pair's twiddle W_M^(n*k) is applied to the output.
+ *
+ * @tparam STAGE Stage index 0 .. LOG2_L-1
+ * @tparam LANE  Lane index, gives every lane its own delay lines
+ * @param re,im  In: stage input sample, Out: stage output sample
+ * @param t      Position of the current sample within the lane frame
+ */
+template <int LOG2_L, int STAGE, int LANE, typename DataT, typename TwiddleT>
+static void sdf_stage(DataT &re, DataT &im, ap_uint<LOG2_L> t) {
+    #pragma HLS INLINE
+    const int LOG2_D = LOG2_L - STAGE - 1;
+    const int D      = 1 << LOG2_D;
+
+    // Feedback delay line, coded as a shift register so it maps to SRLs
+    static DataT dl_re[D], dl_im[D];
+    #pragma HLS ARRAY_PARTITION variable=dl_re complete
+    #pragma HLS ARRAY_PARTITION variable=dl_im complete
+
+    DataT xr = re, xi = im;
+
+    // BF2II: multiply the lower operand by -j in the lower half of the block
+    if ((STAGE & 1) && t[LOG2_D] && !t[LOG2_D + 1]) {
+        DataT tmp = xr;
+        xr = xi;
+        xi = -tmp;
+    }
+
+    // Oldest sample in the delay line (input delayed by D)
+    DataT ar = dl_re[D - 1];
+    DataT ai = dl_im[D - 1];
+
+    DataT yr, yi;   // stage output
+    DataT fr, fi;   // value fed back into the delay line
+    if (t[LOG2_D]) {
+        // Second half of the 2D block: butterfly, a + b out, a - b back
+        yr = ar + xr;
+        yi = ai + xi;
+        fr = ar - xr;
+        fi = ai - xi;
+    } else {
+        // First half: drain previous a - b results, store new input
+        yr = ar;
+        yi = ai;
+        fr = xr;
+        fi = xi;
+    }
+
+    SHIFT_LOOP: for (int j = D - 1; j > 0; j--) {
+        #pragma HLS UNROLL
+        dl_re[j] = dl_re[j - 1];
+        dl_im[j] = dl_im[j - 1];
+    }
+    dl_re[0] = fr;
+    dl_im[0] = fi;
+
+    // Twiddle after each BF2II, except the last pair where it is trivial
+    if ((STAGE & 1) && STAGE < LOG2_L - 1) {
+        // Output position within the pair block of M = 4D samples
+        const int M = 4 * D;
+        ap_uint<2> quarter = (ap_uint<2>)((t >> LOG2_D) + 1);
+        ap_uint<2> n;                               // bit-reversed quarter
+        n[1] = quarter[0];
+        n[0] = quarter[1];
+        ap_uint<fft_log2(M)> k = t & (D - 1);
+        ap_uint<fft_log2(M)> e = n * k;             // W_M^(n*k), n*k < 3M/4
+
+        complex_mul(yr, yi, twiddle_full<M, TwiddleT>(e), re, im);
+    } else {
+        re = yr;
+        im = yi;
+    }
+}
+
+/**
+ * @brief Chain of SDF stages STAGE .. LOG2_L-1 (compile-time recursion)
+ */
+template <int LOG2_L, int STAGE, int LANE, typename DataT, typename TwiddleT,
+          bool END = (STAGE == LOG2_L)>
+struct sdf_chain {
+    static void run(DataT &re, DataT &im, ap_uint<LOG2_L> t) {
+        #pragma HLS INLINE
+        sdf_stage<LOG2_L, STAGE, LANE, DataT, TwiddleT>(re, im, t);
+        sdf_chain<LOG2_L, STAGE + 1, LANE, DataT, TwiddleT>::run(re, im, t);
+    }
+};
+
+template <int LOG2_L, int STAGE, int LANE, typename DataT, typename TwiddleT>
+struct sdf_chain<LOG2_L, STAGE, LANE, DataT, TwiddleT, true> {
+    static void run(DataT &, DataT &, ap_uint<LOG2_L>) {}
+};
+
+/**
+ * @brief Lane pipelines LANE .. FFT_SSR-1, one sample each per clock
+ */
+template <int LOG2_L, int LANE, typename DataT, typename TwiddleT,
+          bool END = (LANE == FFT_SSR)>
+struct sdf_lanes {
+    static void run(DataT re[FFT_SSR], DataT im[FFT_SSR], ap_uint<LOG2_L> t) {
+        #pragma HLS INLINE
+        sdf_chain<LOG2_L, 0, LANE, DataT, TwiddleT>::run(re[LANE], im[LANE], t);
+        sdf_lanes<LOG2_L, LANE + 1, DataT, TwiddleT>::run(re, im, t);
+    }
+};
+
+template <int LOG2_L, int LANE, typename DataT, typename TwiddleT>
+struct sdf_lanes<LOG2_L, LANE, DataT, TwiddleT, true> {
+    static void run(DataT[FFT_SSR], DataT[FFT_SSR], ap_uint<LOG2_L>) {}
+};
+
+/**
+ * @brief Combine lane bin k1 into output bins k1 + (N / FFT_SSR) * k2
+ *
+ * Applies W_N^(l * k1) to lane l, then an in-place FFT_SSR-point radix-2
+ * DIT network across the lanes; re[k2], im[k2] hold bin k1 + L * k2.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void lane_combine(DataT re[FFT_SSR], DataT im[FFT_SSR],
+                         ap_uint<fft_log2(N / FFT_SSR)> k1) {
+    #pragma HLS INLINE
+    DataT xr[FFT_SSR], xi[FFT_SSR];
+    #pragma HLS ARRAY_PARTITION variable=xr complete
+    #pragma HLS ARRAY_PARTITION variable=xi complete
+
+    // Inter-lane twiddles, stored in bit-reversed lane order for the DIT network
+    LANE_TW_LOOP: for (int l = 0; l < FFT_SSR; l++) {
+        #pragma HLS UNROLL
+        int dst = 0;
+        for (int i = 0; i < LOG2_FFT_SSR; i++) {
+            dst |= ((l >> i) & 1) << (LOG2_FFT_SSR - 1 - i);
+        }
+        if (l == 0) {
+            xr[dst] = re[l];
+            xi[dst] = im[l];
+        } else {
+            complex_mul(re[l], im[l], twiddle_full<N, TwiddleT>(l * k1), xr[dst], xi[dst]);
+        }
+    }
+
+    LANE_STAGE_LOOP: for (int stage = 0; stage < LOG2_FFT_SSR; stage++) {
+        #pragma HLS UNROLL
+        int half = 1 << stage;
+        LANE_BF_LOOP: for (int k = 0; k < FFT_SSR / 2; k++) {
+            #pragma HLS UNROLL
+            int j       = k & (half - 1);
+            int idx_top = ((k >> stage) << (stage + 1)) + j;
+            int idx_bot = idx_top + half;
+            int tw_idx  = j * (FFT_SSR >> stage);   // W_(2*half)^j, constant
+
+            DataT tr, ti;
+            complex_mul(xr[idx_bot], xi[idx_bot],
+                        twiddle_at<2 * FFT_SSR, TwiddleT>(tw_idx), tr, ti);
+            DataT ar = xr[idx_top];
+            DataT ai = xi[idx_top];
+            xr[idx_top] = ar + tr;
+            xi[idx_top] = ai + ti;
+            xr[idx_bot] = ar - tr;
+            xi[idx_bot] = ai - ti;
+        }
+    }
+
+    COMBINE_OUT_LOOP: for (int l = 0; l < FFT_SSR; l++) {
+        #pragma HLS UNROLL
+        re[l] = xr[l];
+        im[l] = xi[l];
+    }
+}
+
+/**
+ * @brief Stream one frame through the SDF pipeline at FFT_SSR samples per clock
+ *
+ * The lane pipelines have a latency of N / FFT_SSR - 1 beats; one extra
+ * register aligns their bit-reversed output to the frame boundary. The
+ * reorder buffer then needs one more frame, so the spectrum written out
+ * belongs to the frame read FFT_FRAME_LATENCY calls earlier. With a single
+ * rewound loop the pipeline does not drain between calls, so auto-restart
+ * keeps the input at II=1 across back-to-back frames, and a batch of
+ * frames runs as one long flattened loop.
+ *
+ * Reorder banking: bin k = k1 + L * k2 lives in bank (k1 + k2) % FFT_SSR
+ * at address k / FFT_SSR. The FFT_SSR bins produced together (same k1)
+ * and the FFT_SSR bins of one output beat (same k2) both hit every bank
+ * exactly once, so each bank sees one write and one read per clock and
+ * the data is only rotated between lanes and banks.
+ *
+ * With FFT_SDF_REORDER 0 the reorder buffer is left out and the combined
+ * lane bins go straight to the output in digit-reversed order, one frame
+ * after their input.
+ */
+template <int N, typename DataT, typename TwiddleT>
+static void fft_sdf(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream,
+                    fft_ctrl_t ctrl, fft_frames_t frames, int hop_beats FFT_WIN_PARAM(N)) {
+    #pragma HLS INLINE
+    const int BEATS      = N / FFT_SSR;
+    const int LOG2_BEATS = fft_log2(BEATS);
+    static_assert(BEATS >= FFT_SSR, "SSR reorder needs N >= FFT_SSR^2");
+
+    static DataT pad_re[FFT_SSR], pad_im[FFT_SSR];
+    #pragma HLS ARRAY_PARTITION variable=pad_re complete
+    #pragma HLS ARRAY_PARTITION variable=pad_im complete
+#if FFT_SDF_REORDER
+    static DataT ro_real[FFT_SSR][2 * BEATS], ro_imag[FFT_SSR][2 * BEATS];
+    #pragma HLS ARRAY_PARTITION variable=ro_real complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=ro_imag complete dim=1
+    static ap_uint<1> bank = 0;
+#endif
+    // Direction of the frames still in flight; [FFT_FRAME_LATENCY-1] is output now
+    static fft_ctrl_t ctrl_hist[FFT_FRAME_LATENCY];
+    #pragma HLS ARRAY_PARTITION variable=ctrl_hist complete
+    // Channel of the frame being read and of the frames in flight
+    static fft_chan_t in_chan = 0;
+    static fft_chan_t chan_hist[FFT_FRAME_LATENCY];
+    #pragma HLS ARRAY_PARTITION variable=chan_hist complete
+#if FFT_SCALAR_OUT
+    static float pend_sc[FFT_SSR];   // scalars of the last even beat
+    #pragma HLS ARRAY_PARTITION variable=pend_sc complete
+#endif
+
+    // One flat loop over the batch so frames follow each other without a gap
+    SDF_LOOP: for (int n = 0; n < frames * BEATS; n++) {
+        #pragma HLS PIPELINE II=1 rewind
+        #pragma HLS LOOP_TRIPCOUNT min=BEATS max=BEATS
+        const int  b          = n & (BEATS - 1);
+        const bool last_frame = (n >> LOG2_BEATS) == frames - 1;
+#if FFT_SDF_REORDER
+        // Reorder banks are written and read in different frames
+        #pragma HLS DEPENDENCE variable=ro_real inter false
+        #pragma HLS DEPENDENCE variable=ro_imag inter false
+#endif
+
+        ap_uint<LOG2_BEATS> t = b;
+
+        DataT re[FFT_SSR], im[FFT_SSR];
+        #pragma HLS ARRAY_PARTITION variable=re complete
+        #pragma HLS ARRAY_PARTITION variable=im complete
+        fft_chan_t beat_chan = in_chan;
+        beat_t in_data = stft_read<N>(in_stream, b, BEATS, hop_beats, b == BEATS - 1, beat_chan);
+        if (b == 0) in_chan = beat_chan;
+        UNPACK_LOOP: for (int l = 0; l < FFT_SSR; l++) {
+            #pragma HLS UNROLL
+            fixed_t in_re, in_im;
+            unpack_lane(in_data, l, in_re, in_im);
+            re[l] = in_re;
+            im[l] = inverse_input<DataT>(in_im, ctrl);
+        }
+#if FFT_SSR == 1
+        window_input<N, DataT>(re[0], im[0], t, fft_log2(N), ctrl FFT_WIN_ARG);
+#elif FFT_WINDOW != FFT_WINDOW_NONE
+        // Two lanes: beat b is coefficient pair b
+        if (ctrl & FFT_CTRL_WINDOW) {
+            window_t w0, w1;
+            window_pair<N>(t, fft_log2(N) FFT_WIN_ARG, w0, w1);
+            re[0] = (DataT)(re[0] * w0);
+            im[0] = (DataT)(im[0] * w0);
+            re[1] = (DataT)(re[1] * w1);
+            im[1] = (DataT)(im[1] * w1);
+        }
+#endif
+
+        // Lane bin k1 of the previous frame -> output bins k1 + BEATS * k2
+        ap_uint<LOG2_BEATS> k1 = bit_reverse_idx<LOG2_BEATS>(t);
+        DataT xr[FFT_SSR], xi[FFT_SSR];
+        #pragma HLS ARRAY_PARTITION variable=xr complete
+        #pragma HLS ARRAY_PARTITION variable=xi complete
+        PAD_LOOP: for (int l = 0; l < FFT_SSR; l++) {
+            #pragma HLS UNROLL
+            xr[l] = pad_re[l];
+            xi[l] = pad_im[l];
+        }
+        lane_combine<N, DataT, TwiddleT>(xr, xi, k1);
+
+        sdf_lanes<LOG2_BEATS, 0, DataT, TwiddleT>::run(re, im, t);
+        PAD_UPD_LOOP: for (int l = 0; l < FFT_SSR; l++) {
+            #pragma HLS UNROLL
+            pad_re[l] = re[l];
+            pad_im[l] = im[l];
+        }
+
+        axis_t out_val;
+#if FFT_SDF_REORDER
+        // Write bins in natural order, skewed across the banks
+        RO_WR_LOOP: for (int d = 0; d < FFT_SSR; d++) {
+            #pragma HLS UNROLL
+            ap_uint<LOG2_FFT_SSR + 1> k2 = (d - k1) & (FFT_SSR - 1);
+            ap_uint<LOG2_BEATS> addr = k2 * (BEATS / FFT_SSR) + (k1 >> LOG2_FFT_SSR);
+            ap_uint<LOG2_BEATS + 1> wr_addr = (bank, addr);
+            ro_real[d][wr_addr] = xr[k2];
+            ro_imag[d][wr_addr] = xi[k2];
+        }
+
+        // Read beat t of the previous frame: bins t * FFT_SSR + j
+        ap_uint<LOG2_BEATS + 1> rd_addr = ((ap_uint<1>)~bank, t);
+        ap_uint<LOG2_FFT_SSR + 1> k2_rd = t >> (LOG2_BEATS - LOG2_FFT_SSR);
+        DataT rd_re[FFT_SSR], rd_im[FFT_SSR];
+        #pragma HLS ARRAY_PARTITION variable=rd_re complete
+        #pragma HLS ARRAY_PARTITION variable=rd_im complete
+        RO_RD_LOOP: for (int d = 0; d < FFT_SSR; d++) {
+            #pragma HLS UNROLL
+            rd_re[d] = ro_real[d][rd_addr];
+            rd_im[d] = ro_imag[d][rd_addr];
+            inverse_output<DataT>(rd_re[d], rd_im[d], ctrl_hist[FFT_FRAME_LATENCY - 1], fft_log2(N));
+        }
+
+        DataT ob_re[FFT_SSR], ob_im[FFT_SSR];
+        #pragma HLS ARRAY_PARTITION variable=ob_re complete
+        #pragma HLS ARRAY_PARTITION variable=ob_im complete
+        PACK_LOOP: for (int j = 0; j < FFT_SSR; j++) {
+            #pragma HLS UNROLL
+            int d = (j + k2_rd) & (FFT_SSR - 1);
+            ob_re[j] = rd_re[d];
+            ob_im[j] = rd_im[d];
+            pack_lane(out_val.data, j, (fixed_t)ob_re[j], (fixed_t)ob_im[j]);
+        }
+#else
+        // Lane j carries bin k1 + BEATS * j
+        DataT ob_re[FFT_SSR], ob_im[FFT_SSR];
+        #pragma HLS ARRAY_PARTITION variable=ob_re complete
+        #pragma HLS ARRAY_PARTITION variable=ob_im complete
+        PACK_LOOP: for (int j = 0; j < FFT_SSR; j++) {
+            #pragma HLS UNROLL
+            ob_re[j] = xr[j];
+            ob_im[j] = xi[j];
+            inverse_output<DataT>(ob_re[j], ob_im[j], ctrl_hist[FFT_FRAME_LATENCY - 1], fft_log2(N));
+            pack_lane(out_val.data, j, (fixed_t)ob_re[j], (fixed_t)ob_im[j]);
+        }
+#endif
+        const fft_ctrl_t out_ctrl = ctrl_hist[FFT_FRAME_LATENCY - 1];
+        const int beats_out = (out_ctrl & FFT_CTRL_HALF) ? BEATS / 2 : BEATS;
+        bool emit = (b < beats_out);
+#if FFT_SCALAR_OUT
+        // Scalar formats: the FFT_SSR bins of an even beat wait for the next beat
+        const fft_ctrl_t fmt = out_ctrl & FFT_CTRL_FORMAT;
+        if (fmt != FFT_CTRL_FMT_COMPLEX) {
+            float sc[2 * FFT_SSR];
+            #pragma HLS ARRAY_PARTITION variable=sc complete
+            SCALAR_LOOP: for (int j = 0; j < FFT_SSR; j++) {
+                #pragma HLS UNROLL
+                sc[j]           = pend_sc[j];
+                sc[FFT_SSR + j] = spectrum_scalar<DataT>(ob_re[j], ob_im[j], fmt, 0);
+                pend_sc[j]      = sc[FFT_SSR + j];
+            }
+            SCALAR_PACK_LOOP: for (int j = 0; j < FFT_SSR; j++) {
+                #pragma HLS UNROLL
+                pack_scalars(out_val.data, j, sc[2 * j], sc[2 * j + 1]);
+            }
+            emit = emit && (b & 1);
+        }
+#endif
+        out_val.keep = -1;   // all bytes valid
+        out_val.strb = -1;
+        out_val.last = (b == beats_out - 1 && (last_frame || !(ctrl & FFT_CTRL_BATCH_TLAST))) ? 1 : 0;
+        axis_set_chan(out_val, chan_hist[FFT_FRAME_LATENCY - 1]);
+        if (emit) out_stream.write(out_val);
+
+        if (b == BEATS - 1) {
+#if FFT_SDF_REORDER
+            bank = ~bank;
+#endif
+            CTRL_HIST_LOOP: for (int f = FFT_FRAME_LATENCY - 1; f > 0; f--) {
+                #pragma HLS UNROLL
+                ctrl_hist[f] = ctrl_hist[f - 1];
+                chan_hist[f] = chan_hist[f - 1];
+            }
+            ctrl_hist[0] = ctrl;
+            chan_hist[0] = in_chan;
+        }
+    }
+}
+
+/* ================================================================
+ *  Engine Entry Point
+ * ================================================================ */
+
+/**
+ * @brief N-point FFT on AXI-Stream with the engine selected by FFT_ENGINE
+ *
+ * The memory and staged engines transform 2^log2_len points per call
+ * (16 .. N); the SDF engine's delay lines are sized for N at synthesis
+ * and it always runs N points. ctrl selects the direction of the frame
+ * read in this call; the SDF engine applies it to the output
+ * FFT_FRAME_LATENCY frames later, along with the frame itself. One call
+ * runs `frames` frames back to back: the memory and staged engines loop
+ * over the DATAFLOW region, so frame f + 1 is read while frame f is
+ * transformed, and the SDF loop is extended to frames * N / FFT_SSR beats.
+ * With FFT_INPLACE the memory engine's loop body is sequential instead,
+ * on a single buffer pair.
+ *
+ * @tparam N        Transform size (power of two)
+ * @tparam DataT    Internal sample type
+ * @tparam TwiddleT Twiddle ROM type
+ * @param log2_len  log2 of the active length (see decode_log2_len)
+ * @param ctrl      FFT_CTRL_* bits
+ * @param frames    Frames in this call (1 .. 65535)
+ * @param hop       New input words per frame, 0 for none reused (FFT_STFT)
+ * @param avg_frames Power spectra per averaged output frame (FFT_AVG)
+ * @param peak_thresh Least |X|^2 of a reported peak (FFT_PEAKS)
+ * @param perf      Counter registers, written after every frame (FFT_PERF)
+ * @param filter_coef Frequency response RAM (FFT_FASTCONV only)
+ * @param pfb_coef  PFB prototype RAM (FFT_PFB_TAPS only)
+ * @param window_coef Window RAM (FFT_WINDOW_RAM only)
+ */
+template <int N, typename DataT, typename TwiddleT>
+void fft_core(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream,
+              log2_len_t log2_len, fft_ctrl_t ctrl, fft_frames_t frames, fft_hop_t hop,
+              fft_frames_t avg_frames FFT_PEAK_PARAM FFT_PERF_PARAM FFT_FILT_PARAM(N) FFT_PFB_PARAM(N)
+              FFT_WIN_PARAM(N)) {
+    static_assert((N & (N - 1)) == 0 && N >= 16 && N <= 4096,
+                  "N must be a power of two from 16 to 4096");
+
+#if FFT_ENGINE == FFT_ENGINE_SDF
+    // ---- Streaming engine: inlined so the rewound loop is the caller's only loop ----
+    #pragma HLS INLINE
+    (void)log2_len;
+    (void)avg_frames;
+    fft_sdf<N, DataT, TwiddleT>(in_stream, out_stream, ctrl, frames,
+                                stft_hop_beats(hop, N / FFT_SSR) FFT_WIN_ARG);
+#else
+    const int hop_beats = stft_hop_beats(hop, 1 << log2_len);
+#if FFT_FASTCONV
+    // Time-domain frames on both streams; the inverse is set up by filter_multiply
+    const fft_ctrl_t in_ctrl   = ctrl & ~(fft_ctrl_t)(FFT_CTRL_INVERSE | FFT_CTRL_BITREV_IN);
+    const fft_ctrl_t out_ctrl  = FFT_CTRL_INVERSE | FFT_CTRL_SCALE;
+    const int        out_first = (1 << log2_len) - hop_beats;
+#else
+    const fft_ctrl_t in_ctrl   = ctrl;
+    const fft_ctrl_t out_ctrl  = ctrl;
+    const int        out_first = 0;
+#endif
+    BATCH_LOOP: for (fft_frames_t f = 0; f < frames; f++) {
+    #pragma HLS LOOP_TRIPCOUNT min=1 max=1
+#if FFT_INPLACE
+    // ---- Sequential: read, butterflies and write share one buffer pair ----
+    DataT out_real[N], out_imag[N];
+    DataT (&rev_real)[N] = out_real;
+    DataT (&rev_imag)[N] = out_imag;
+#if FFT_MEM_BANKS > 1
+    #pragma HLS ARRAY_PARTITION variable=out_real block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=out_imag block factor=FFT_MEM_BANKS
+#endif
+#else
+    // ---- DATAFLOW: overlap I/O with computation, also across frames ----
+    #pragma HLS DATAFLOW
+
+    // Intermediate buffers (become PIPO buffers in DATAFLOW)
+    DataT rev_real[N], rev_imag[N];
+    DataT out_real[N], out_imag[N];
+#if FFT_MEM_BANKS > 1
+    // One PIPO bank per butterfly operand (see mem_phys)
+    #pragma HLS ARRAY_PARTITION variable=rev_real block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=rev_imag block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=out_real block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=out_imag block factor=FFT_MEM_BANKS
+#endif
+#endif
+
+#if FFT_CHANNELS > 1
+    // Frame channel, read_input -> write_output around the stages
+    const int CHAN_DEPTH = fft_log2(N) + 3;
+    hls::stream<fft_chan_t> chan_tok("chan_tok");
+    #pragma HLS STREAM variable=chan_tok depth=CHAN_DEPTH
+    (void)CHAN_DEPTH;   // read by the pragma only
+#define FFT_CHAN_IN(a) , a
+#else
+#define FFT_CHAN_IN(a)
+#endif
+
+#if FFT_BFP
+    // Frame peak / exponent tokens between the processes
+    hls::stream<bfp_token<DataT> > bfp_rd("bfp_rd"), bfp_wr("bfp_wr");
+#endif
+
+#if FFT_PERF
+    // Frame event counts between the processes
+    hls::stream<perf_token> perf_rd("perf_rd"), perf_wr("perf_wr");
+#define FFT_PERF_OUT(clear, tok) , perf, clear, tok
+#else
+#define FFT_PERF_OUT(clear, tok)
+#endif
+
+#if FFT_PFB_TAPS
+#define FFT_PFB_IN(load) , pfb_coef, load
+#else
+#define FFT_PFB_IN(load)
+#endif
+
+    // Stage 1: Read input stream in bit-reversed order
+    read_input<N, FFT_MEM_BANKS>(in_stream, rev_real, rev_imag, log2_len, in_ctrl, hop_beats FFT_WIN_ARG
+                                 FFT_PFB_IN((ctrl & FFT_CTRL_PFB_LOAD) && f == 0)
+                                 FFT_CHAN_IN(chan_tok) FFT_PERF_IN(perf_rd) FFT_BFP_IN(bfp_rd));
+
+#if FFT_FASTCONV
+    // Stage 2: forward butterflies, filter multiply, inverse butterflies
+    DataT fwd_real[N], fwd_imag[N];
+    DataT flt_real[N], flt_imag[N];
+#if FFT_MEM_BANKS > 1
+    #pragma HLS ARRAY_PARTITION variable=fwd_real block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=fwd_imag block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=flt_real block factor=FFT_MEM_BANKS
+    #pragma HLS ARRAY_PARTITION variable=flt_imag block factor=FFT_MEM_BANKS
+#endif
+#if FFT_BFP
+    hls::stream<bfp_token<DataT> > bfp_fwd("bfp_fwd"), bfp_flt("bfp_flt");
+#endif
+#if FFT_PERF
+    hls::stream<perf_token> perf_fwd("perf_fwd"), perf_flt("perf_flt");
+#endif
+    fft_butterflies<N, DataT, TwiddleT>(rev_real, rev_imag, fwd_real, fwd_imag, log2_len
+                                        FFT_BFP_IO(bfp_rd, bfp_fwd) FFT_PERF_IO(perf_rd, perf_fwd));
+    filter_multiply<N, FFT_MEM_BANKS, DataT>(fwd_real, fwd_imag, flt_real, flt_imag, log2_len FFT_FILT_ARG
+                                             FFT_BFP_IO(bfp_fwd, bfp_flt) FFT_PERF_IO(perf_fwd, perf_flt));
+    fft_butterflies<N, DataT, TwiddleT>(flt_real, flt_imag, out_real, out_imag, log2_len
+                                        FFT_BFP_IO(bfp_flt, bfp_wr) FFT_PERF_IO(perf_flt, perf_wr));
+#else
+    // Stage 2: FFT butterfly stages
+    fft_butterflies<N, DataT, TwiddleT>(rev_real, rev_imag, out_real, out_imag, log2_len
+                                        FFT_BFP_IO(bfp_rd, bfp_wr) FFT_PERF_IO(perf_rd, perf_wr));
+#endif
+
+    // Stage 3: Write output stream
+    write_output<N, FFT_MEM_BANKS, DataT, TwiddleT>(out_real, out_imag, out_stream, log2_len, out_ctrl,
+                                                    !(ctrl & FFT_CTRL_BATCH_TLAST) || f == frames - 1, out_first,
+                                                    avg_frames FFT_PEAK_ARG FFT_CHAN_IN(chan_tok)
+                                                    FFT_PERF_OUT((ctrl & FFT_CTRL_PERF_CLEAR) && f == 0, perf_wr)
+                                                    FFT_BFP_IN(bfp_wr));
+#undef FFT_CHAN_IN
+#undef FFT_PERF_OUT
+#undef FFT_PFB_IN
+    }
+#endif
+}
+
+/* ================================================================
+ *  Engine Array (FFT_ENGINES)
+ * ================================================================ */
+
+#if FFT_ENGINES > 1
+/**
+ * @brief Deal whole input frames to the engine streams, round-robin
+ *
+ * Frame f of the batch goes to engine f % FFT_ENGINES; frames are counted
+ * in beats of the active length, as read_input does.
+ */
+template <int N>
+static void engine_dispatch(hls::stream<axis_t> &in_stream,
+                            hls::stream<axis_t> eng_in[FFT_ENGINES],
+                            log2_len_t log2_len, fft_frames_t frames) {
+    const int         beats = 1 << log2_len;
+    const fft_words_t words = (fft_words_t)frames * beats;
+    int b = 0;
+    int e = 0;
+    DISPATCH_LOOP: for (fft_words_t i = 0; i < words; i++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=N
+        eng_in[e].write(in_stream.read());
+        if (b == beats - 1) {
+            b = 0;
+            e = (e == FFT_ENGINES - 1) ? 0 : e + 1;
+        } else {
+            b++;
+        }
+    }
+}
+
+/**
+ * @brief Collect the engines' output frames in batch order
+ *
+ * The engines run without FFT_CTRL_BATCH_TLAST, so every frame ends in
+ * TLAST whatever its length (FFT_CTRL_HALF, scalar formats, peak
+ * records); TLAST is then kept on every frame or only on the batch's last
+ * one, as ctrl asks.
+ */
+template <int N>
+static void engine_collect(hls::stream<axis_t> eng_out[FFT_ENGINES],
+                           hls::stream<axis_t> &out_stream,
+                           fft_ctrl_t ctrl, fft_frames_t frames) {
+    const bool batch_tlast = ctrl & FFT_CTRL_BATCH_TLAST;
+    fft_frames_t f = 0;
+    int e = 0;
+    COLLECT_LOOP: while (f < frames) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=N
+        axis_t beat = eng_out[e].read();
+        const bool frame_end = beat.last;
+        beat.last = (frame_end && (!batch_tlast || f == frames - 1)) ? 1 : 0;
+        out_stream.write(beat);
+        if (frame_end) {
+            f++;
+            e = (e == FFT_ENGINES - 1) ? 0 : e + 1;
+        }
+    }
+}
+#endif
+
+/**
+ * @brief fft_core, or FFT_ENGINES copies of it behind one stream pair
+ *
+ * Same arguments as fft_core. With FFT_ENGINES > 1, engine e runs frames
+ * e, e + FFT_ENGINES, ... of the batch as its own batch, concurrently with
+ * the others in one DATAFLOW region.
+ */
+template <int N, typename DataT, typename TwiddleT>
+void fft_engines(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream,
+                 log2_len_t log2_len, fft_ctrl_t ctrl, fft_frames_t frames, fft_hop_t hop,
+                 fft_frames_t avg_frames FFT_PEAK_PARAM FFT_PERF_PARAM FFT_FILT_PARAM(N) FFT_PFB_PARAM(N)
+                 FFT_WIN_PARAM(N)) {
+#if FFT_ENGINES == 1
+    #pragma HLS INLINE
+    fft_core<N, DataT, TwiddleT>(in_stream, out_stream, log2_len, ctrl, frames, hop,
+                                 avg_frames FFT_PEAK_ARG FFT_PERF_ARG FFT_FILT_ARG FFT_PFB_ARG FFT_WIN_ARG);
+#else
+    #pragma HLS DATAFLOW
+    hls::stream<axis_t> eng_in[FFT_ENGINES], eng_out[FFT_ENGINES];
+    const fft_ctrl_t eng_ctrl = ctrl & ~(fft_ctrl_t)FFT_CTRL_BATCH_TLAST;
+
+    engine_dispatch<N>(in_stream, eng_in, log2_len, frames);
+    ENGINE_LOOP: for (int e = 0; e < FFT_ENGINES; e++) {
+        #pragma HLS UNROLL
+        fft_core<N, DataT, TwiddleT>(eng_in[e], eng_out[e], log2_len, eng_ctrl,
+                                     (frames + (FFT_ENGINES - 1 - e)) / FFT_ENGINES, hop,
+                                     avg_frames FFT_PEAK_ARG FFT_PERF_ARG FFT_FILT_ARG FFT_PFB_ARG FFT_WIN_ARG);
+    }
+    engine_collect<N>(eng_out, out_stream, ctrl, frames);
+#endif
+}
+
+#undef FFT_WIN_PARAM
+#undef FFT_WIN_ARG
+#undef FFT_FILT_PARAM
+#undef FFT_FILT_ARG
+#undef FFT_PFB_PARAM
+#undef FFT_PFB_ARG
+#undef FFT_PEAK_PARAM
+#undef FFT_PEAK_ARG
+#undef FFT_PERF_PARAM
+#undef FFT_PERF_ARG
+#undef FFT_BFP_IO
+#undef FFT_BFP_IN
+#undef FFT_PERF_IO
+#undef FFT_PERF_IN
+
+#endif // FFT_CORE_H
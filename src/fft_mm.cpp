@@ -0,0 +1,183 @@
+/**
+ * @file fft_mm.cpp
+ * @brief Memory-mapped FFT top level (FFT_MM): frames from and to DDR
+ *
+ * Instantiates the same fft_core<FFT_SIZE, sample_t, twiddle_t> as fft.cpp
+ * between two m_axi burst processes:
+ *   - mm_read  bursts the input frames from `src` and tags them as AXI-Stream
+ *     beats (TLAST per frame, TID = frame % FFT_CHANNELS)
+ *   - fft_core runs the batch with FFT_CTRL_BATCH_TLAST forced
+ *   - mm_write bursts the results to `dst` until the batch TLAST
+ * All three are DATAFLOW processes, so reads, transforms and writes of
+ * consecutive frames overlap and no external DMA is needed.
+ */
+
+#include "fft.h"
+#include "fft_core.h"
+
+#if FFT_MM
+
+/* ================================================================
+ *  Memory Burst Processes
+ * ================================================================ */
+
+/**
+ * @brief Read num_frames input frames from DDR into the engine's stream
+ *
+ * A frame is fft_len / FFT_SSR words (FFT_SIZE / FFT_SSR for the SDF
+ * engine), or hop words with the FFT_STFT history. The words are
+ * consecutive, so the loop becomes one long read burst.
+ */
+static void mm_read(const beat_t *src, hls::stream<axis_t> &in_stream,
+                    fft_len_t fft_len, fft_frames_t frames, fft_hop_t hop) {
+#if FFT_ENGINE == FFT_ENGINE_SDF
+    (void)fft_len;
+    const int beats = FFT_BEATS;
+#else
+    const int beats = 1 << decode_log2_len<FFT_SIZE>(fft_len);
+#endif
+    const int   frame_words = stft_hop_beats(hop, beats);
+    fft_words_t words       = (fft_words_t)frames * frame_words;
+    int        b    = 0;
+    fft_chan_t chan = 0;
+    MM_READ_LOOP: for (fft_words_t i = 0; i < words; i++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=FFT_MM_DEPTH
+        axis_t beat;
+        beat.data = src[i];
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (b == frame_words - 1) ? 1 : 0;
+        axis_set_chan(beat, chan);
+        in_stream.write(beat);
+        if (b == frame_words - 1) {
+            b = 0;
+            chan++;   // wraps at FFT_CHANNELS
+        } else {
+            b++;
+        }
+    }
+}
+
+/**
+ * @brief Write the engine's output to DDR up to the batch TLAST
+ *
+ * No frame emits more than FFT_BEATS words (nor the at most 16 peak
+ * records of an FFT_PEAKS frame), so frames * FFT_BEATS bounds the burst;
+ * the actual length depends on the format, FFT_CTRL_HALF, averaging, fast
+ * convolution and peak records and is returned in out_words.
+ */
+static void mm_write(hls::stream<axis_t> &out_stream, beat_t *dst,
+                     fft_frames_t frames, fft_words_t &out_words) {
+    const fft_words_t max_words = (fft_words_t)frames * FFT_BEATS;
+    fft_words_t n = 0;
+    MM_WRITE_LOOP: for (fft_words_t i = 0; i < max_words; i++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS LOOP_TRIPCOUNT min=16 max=FFT_MM_DEPTH
+        axis_t beat = out_stream.read();
+        dst[i] = beat.data;
+        // A null TLAST beat (FFT_AVG batch ending inside a block) is not counted
+        n = (beat.keep != 0) ? (fft_words_t)(i + 1) : i;
+        if (beat.last) break;
+    }
+    out_words = n;
+}
+
+/* ================================================================
+ *  Top-Level Function
+ * ================================================================ */
+void fft_mm(const beat_t *src, beat_t *dst, fft_len_t fft_len, fft_ctrl_t ctrl,
+            fft_frames_t num_frames, fft_words_t &out_words
+#if FFT_STFT
+            , fft_hop_t hop
+#endif
+#if FFT_AVG
+            , fft_frames_t avg_frames
+#endif
+#if FFT_PEAKS
+            , fft_thresh_t peak_thresh
+#endif
+#if FFT_PERF
+            , fft_perf_t perf[FFT_PERF_REGS]
+#endif
+#if FFT_FASTCONV
+            , const filter_word_t filter_coef[FFT_SIZE]
+#endif
+#if FFT_PFB_TAPS
+            , const pfb_word_t pfb_coef[FFT_PFB_TAPS * FFT_SIZE / 2]
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+            , const window_word_t window_coef[FFT_WINDOW_LEN / 2]
+#endif
+            ) {
+    // ---- Interface Pragmas ----
+    #pragma HLS INTERFACE m_axi port=src offset=slave bundle=gmem_in depth=FFT_MM_DEPTH \
+        max_read_burst_length=256 num_read_outstanding=4
+    #pragma HLS INTERFACE m_axi port=dst offset=slave bundle=gmem_out depth=FFT_MM_DEPTH \
+        max_write_burst_length=256 num_write_outstanding=4
+    #pragma HLS INTERFACE s_axilite port=src
+    #pragma HLS INTERFACE s_axilite port=dst
+    #pragma HLS INTERFACE s_axilite port=fft_len
+    #pragma HLS INTERFACE s_axilite port=ctrl
+    #pragma HLS INTERFACE s_axilite port=num_frames
+    #pragma HLS INTERFACE s_axilite port=out_words
+#if FFT_STFT
+    #pragma HLS INTERFACE s_axilite port=hop
+#endif
+#if FFT_AVG
+    #pragma HLS INTERFACE s_axilite port=avg_frames
+#endif
+#if FFT_PEAKS
+    #pragma HLS INTERFACE s_axilite port=peak_thresh
+#endif
+#if FFT_PERF
+    #pragma HLS INTERFACE s_axilite port=perf
+#endif
+#if FFT_FASTCONV
+    #pragma HLS INTERFACE s_axilite port=filter_coef
+#endif
+#if FFT_PFB_TAPS
+    #pragma HLS INTERFACE s_axilite port=pfb_coef
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+    #pragma HLS INTERFACE s_axilite port=window_coef
+#endif
+    #pragma HLS INTERFACE s_axilite port=return
+
+    // ---- DATAFLOW: DDR read -> engine -> DDR write ----
+    #pragma HLS DATAFLOW
+    hls::stream<axis_t> in_stream("mm_in_stream"), out_stream("mm_out_stream");
+#if !FFT_STFT
+    const fft_hop_t hop = 0;
+#endif
+    const fft_frames_t frames = (num_frames == 0) ? (fft_frames_t)1 : num_frames;
+
+    mm_read(src, in_stream, fft_len, frames, hop);
+    fft_engines<FFT_SIZE, sample_t, twiddle_t>(in_stream, out_stream,
+                                               decode_log2_len<FFT_SIZE>(fft_len),
+                                               ctrl | FFT_CTRL_BATCH_TLAST, frames, hop,
+#if FFT_AVG
+                                               avg_frames
+#else
+                                               0
+#endif
+#if FFT_PEAKS
+                                               , peak_thresh
+#endif
+#if FFT_PERF
+                                               , perf
+#endif
+#if FFT_FASTCONV
+                                               , filter_coef
+#endif
+#if FFT_PFB_TAPS
+                                               , pfb_coef
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+                                               , window_coef
+#endif
+                                               );
+    mm_write(out_stream, dst, frames, out_words);
+}
+
+#endif // FFT_MM
@@ -1,16 +1,48 @@
 /**
  * @file fft_tb.cpp
- * @brief Testbench for 256-point Radix-2 DIT FFT IP
+ * @brief Testbench for the FFT_SIZE-point FFT IP
  *
- * Generates a dual-tone sine wave (10 Hz + 30 Hz within 256 samples),
+ * Generates a dual-tone sine wave (10 + 30 cycles per frame, 2 + 5 below 64 points),
  * feeds it through the FFT, and verifies:
- *   1. Spectral peaks appear at the expected frequency bins (10 and 30)
+ *   1. Spectral peaks appear at the expected frequency bins (TONE1 and TONE2)
  *   2. TLAST is asserted on the last output sample
+ *   3. A 16-point frame selected through the length register peaks at its
+ *      tone bin with TLAST on sample 16 (memory and staged engines)
+ *   4. The scaled inverse transform of the spectrum returns the input
+ *   5. A bit-reversed-output FFT feeding a bit-reversed-input IFFT returns
+ *      the input (memory and staged engines)
+ *   6. Half-spectrum frames (and with FFT_SCALAR_OUT the power, magnitude and
+ *      dB formats) match the complex spectrum of check 1
+ *   7. With FFT_WINDOW, a windowed constant frame has the window's cosine-sum
+ *      coefficients in bins 0 .. 3 (RAM mode loaded with a periodic Hann)
+ *   8. With FFT_PERF, the counters after a cleared frame show one frame, no
+ *      stalls or overflows and each process's loop cycles, with the slowest
+ *      as the frame interval; an overloaded frame raises the overflow count
+ *   9. With FFT_MM, a batch through fft_mm's DDR buffers matches the spectrum
+ *      of check 1 frame by frame (with FFT_AVG also averaging batches that
+ *      end inside a block)
+ *  10. Accuracy benchmark: FFT_TB_BENCH_FRAMES random, impulse and
+ *      full-scale frames in back-to-back batches reach FFT_TB_MIN_SQNR
+ *      against a double-precision FFT, with TLAST on every frame end
+ *  11. With FFT_PFB_TAPS, PFB frames after a prototype load match the FFT
+ *      of the direct polyphase sums (all other checks run unfiltered)
+ *  12. With FFT_PEAKS, the peak records of a three-tone frame list the
+ *      tones strongest first, with and without a threshold between them
+ *      and the noise floor
+ *  13. The host runtime's frame size (fft_frame_words) is exactly what the
+ *      IP reads, for odd, short, long and wrapping length and hop values
+ *
+ * With FFT_FASTCONV the IP is a filter, so only fastconv_check runs: an
+ * asymmetric FIR through overlap-save must match the direct convolution.
+ *
+ * With FFT_REAL the tones are sampled over 2 * FFT_SIZE real points, two per
+ * word, and only the half spectrum (no mirror peaks) is checked.
  *
  * Returns 0 on PASS, 1 on FAIL (compatible with Vitis HLS csim/cosim).
  */
 
 #include "fft.h"
+#include "../host/fft_host.h"
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -19,42 +51,630 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// Accuracy benchmark size and pass level (override with -D)
+#ifndef FFT_TB_BENCH_FRAMES
+#define FFT_TB_BENCH_FRAMES 1024   // frames, cycling through the input classes
+#endif
+#ifndef FFT_TB_BENCH_BATCH
+#define FFT_TB_BENCH_BATCH 16      // frames per num_frames call
+#endif
+#ifndef FFT_TB_MIN_SQNR
+// About 6 dB per fraction bit of the datapath, less the rounding noise of
+// log2(N) stages
+#define FFT_TB_MIN_SQNR (6.02 * (FFT_DATA_W - FFT_DATA_I) - 2.0 * LOG2_FFT_SIZE)
+#endif
+
+#if FFT_WINDOW == FFT_WINDOW_RAM
+// Window RAM image as the host writes it over AXI-Lite
+static window_word_t window_ram[FFT_WINDOW_LEN / 2];
+#endif
+
+// Optional top-level arguments, present only when their option builds them
+#if FFT_STFT
+#define TB_HOP_ARG(h) , h
+#else
+#define TB_HOP_ARG(h)
+#endif
+#if FFT_AVG
+#define TB_AVG_ARG(k) , k
+#else
+#define TB_AVG_ARG(k)
+#endif
+#if FFT_PEAKS
+#define TB_PEAK_ARG(t) , t
+#else
+#define TB_PEAK_ARG(t)
+#endif
+#if FFT_PERF
+// Performance counter bank as the host reads it over AXI-Lite
+static fft_perf_t perf_regs[FFT_PERF_REGS];
+#define TB_PERF_ARG , perf_regs
+#else
+#define TB_PERF_ARG
+#endif
+#if FFT_FASTCONV
+// Filter response RAM image as the host writes it over AXI-Lite
+static filter_word_t filter_ram[FFT_SIZE];
+#define TB_FILT_ARG , filter_ram
+#else
+#define TB_FILT_ARG
+#endif
+#if FFT_PFB_TAPS
+// PFB prototype RAM image as the host writes it over AXI-Lite
+static pfb_word_t pfb_ram[FFT_PFB_TAPS * FFT_SIZE / 2];
+#define TB_PFB_ARG , pfb_ram
+#else
+#define TB_PFB_ARG
+#endif
+#if FFT_WINDOW == FFT_WINDOW_RAM
+#define TB_WIN_ARG , window_ram
+#else
+#define TB_WIN_ARG
+#endif
+
+/**
+ * @brief Call the IP with the current window RAM image (FFT_WINDOW_RAM)
+ *
+ * hop (FFT_STFT), avg_frames (FFT_AVG) and peak_thresh (FFT_PEAKS) are
+ * only passed when built; their defaults read whole frames, disable
+ * averaging and report peaks of any power.
+ */
+static void run_fft(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream,
+                    fft_len_t fft_len, fft_ctrl_t ctrl, fft_frames_t frames = 1,
+                    fft_hop_t hop = 0, fft_frames_t avg_frames = 0, fft_thresh_t peak_thresh = 0) {
+    (void)hop;
+    (void)avg_frames;
+    (void)peak_thresh;
+    fft(in_stream, out_stream, fft_len, ctrl, frames TB_HOP_ARG(hop) TB_AVG_ARG(avg_frames)
+        TB_PEAK_ARG(peak_thresh) TB_PERF_ARG TB_FILT_ARG TB_PFB_ARG TB_WIN_ARG);
+}
+
+/**
+ * @brief Bin carried by output sample i (beat i / FFT_SSR, lane i % FFT_SSR)
+ *
+ * Natural order except for the SDF engine without its reorder buffer,
+ * which emits bin bitrev(beat) + FFT_BEATS * lane.
+ */
+static int output_bin(int i) {
+#if FFT_ENGINE == FFT_ENGINE_SDF && !FFT_SDF_REORDER
+    int beat = i / FFT_SSR, rev = 0;
+    for (int b = 0; b < LOG2_FFT_BEATS; b++) {
+        rev |= ((beat >> b) & 1) << (LOG2_FFT_BEATS - 1 - b);
+    }
+    return rev + FFT_BEATS * (i % FFT_SSR);
+#else
+    return i;
+#endif
+}
+
+#if FFT_STFT
+/**
+ * @brief Stream samples first .. first + count - 1 of a signal, zeros past its end
+ */
+static void send_samples(hls::stream<axis_t> &in_stream, const fixed_t *re, const fixed_t *im,
+                         int len, int first, int count) {
+    for (int b = 0; b < count / FFT_SSR; b++) {
+        axis_t beat;
+        for (int l = 0; l < FFT_SSR; l++) {
+            int n = first + b * FFT_SSR + l;
+            pack_lane(beat.data, l, (n < len) ? re[n] : (fixed_t)0.0,
+                                    (n < len) ? im[n] : (fixed_t)0.0);
+        }
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (b == count / FFT_SSR - 1) ? 1 : 0;
+        in_stream.write(beat);
+    }
+}
+#endif
+
+/**
+ * @brief In-place double-precision radix-2 FFT, the benchmark reference
+ */
+static void ref_fft(double *re, double *im, int n) {
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        for (int k = 0; k < len / 2; k++) {
+            double wr = cos(2.0 * M_PI * k / len), wi = -sin(2.0 * M_PI * k / len);
+            for (int i = k; i < n; i += len) {
+                int    m  = i + len / 2;
+                double tr = re[m] * wr - im[m] * wi;
+                double ti = re[m] * wi + im[m] * wr;
+                re[m] = re[i] - tr;  im[m] = im[i] - ti;
+                re[i] += tr;         im[i] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * @brief SQNR and framing benchmark over FFT_TB_BENCH_FRAMES frames
+ *
+ * Frames cycle through three classes: uniform random samples in [-1, 1),
+ * a unit impulse at a random position, and a tone at a random bin whose
+ * peak reaches 90 % of the datapath range. They are sent in
+ * FFT_TB_BENCH_BATCH-frame calls, as in batch mode, and every output frame
+ * is compared with the double-precision FFT of its quantised input. The
+ * SDF engine's first FFT_FRAME_LATENCY outputs belong to earlier checks;
+ * its last inputs are flushed with zero frames. Returns 1 if a class falls
+ * below FFT_TB_MIN_SQNR or a TLAST is misplaced.
+ */
+static int accuracy_bench(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream) {
+    enum { BENCH_RANDOM, BENCH_IMPULSE, BENCH_FULL_SCALE, BENCH_CLASSES };
+    static const char *const class_name[BENCH_CLASSES] = {"random", "impulse", "full-scale"};
+    const int RING  = FFT_TB_BENCH_BATCH + FFT_FRAME_LATENCY;   // frames awaiting output
+    const int REF_N = FFT_REAL ? 2 * FFT_SIZE : FFT_SIZE;       // reference transform length
+    const int CALLS = (FFT_TB_BENCH_FRAMES + FFT_TB_BENCH_BATCH - 1) / FFT_TB_BENCH_BATCH;
+    const double FULL_SCALE = 0.9 * (1 << (FFT_DATA_I - 1)) / FFT_SIZE;   // tone amplitude
+    static double ref_re[FFT_TB_BENCH_BATCH + FFT_FRAME_LATENCY][FFT_SIZE];
+    static double ref_im[FFT_TB_BENCH_BATCH + FFT_FRAME_LATENCY][FFT_SIZE];
+    static double xr[2 * FFT_SIZE], xi[2 * FFT_SIZE];
+    double sig[BENCH_CLASSES] = {0.0}, noise[BENCH_CLASSES] = {0.0}, max_err[BENCH_CLASSES] = {0.0};
+    int    tlast_error = 0;
+    int    error       = 0;
+
+    srand(2);
+    for (int c = 0; c <= CALLS; c++) {
+        // Call CALLS only flushes the SDF pipeline with zero frames
+        const int frames = (c < CALLS) ? FFT_TB_BENCH_BATCH : FFT_FRAME_LATENCY;
+        if (frames == 0) break;
+        for (int t = 0; t < frames; t++) {
+            const int j   = c * FFT_TB_BENCH_BATCH + t;
+            const int cls = j % BENCH_CLASSES;
+            const int pos = rand() % REF_N;
+            const int bin = FFT_REAL ? 1 + rand() % (FFT_SIZE - 1) : rand() % FFT_SIZE;
+            const double phase = 2.0 * M_PI * rand() / RAND_MAX;
+            for (int n = 0; n < REF_N; n++) {
+                double r = 0.0, i = 0.0;
+                if (c == CALLS) {
+                    // flush frame
+                } else if (cls == BENCH_RANDOM) {
+                    r = 2.0 * rand() / ((double)RAND_MAX + 1.0) - 1.0;
+                    i = 2.0 * rand() / ((double)RAND_MAX + 1.0) - 1.0;
+                } else if (cls == BENCH_IMPULSE) {
+                    r = (n == pos) ? cos(phase) : 0.0;
+                    i = (n == pos) ? sin(phase) : 0.0;
+                } else {
+                    double a = 2.0 * M_PI * bin * n / REF_N + phase;
+                    r = FULL_SCALE * cos(a);
+                    i = FULL_SCALE * sin(a);
+                }
+                xr[n] = r;
+                xi[n] = FFT_REAL ? 0.0 : i;
+            }
+            // One complex word per sample, or two real samples per word (FFT_REAL)
+            for (int b = 0; b < FFT_BEATS; b++) {
+                axis_t beat;
+                for (int l = 0; l < FFT_SSR; l++) {
+                    int     w  = b * FFT_SSR + l;
+                    fixed_t wr = FFT_REAL ? xr[2 * w] : xr[w];
+                    fixed_t wi = FFT_REAL ? xr[2 * w + 1] : xi[w];
+                    pack_lane(beat.data, l, wr, wi);
+                    if (FFT_REAL) {
+                        xr[2 * w] = wr.to_double();
+                        xr[2 * w + 1] = wi.to_double();
+                    } else {
+                        xr[w] = wr.to_double();
+                        xi[w] = wi.to_double();
+                    }
+                }
+                beat.keep = -1;
+                beat.strb = -1;
+                beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+                in_stream.write(beat);
+            }
+            ref_fft(xr, xi, REF_N);
+            for (int k = 0; k < FFT_SIZE; k++) {
+                ref_re[j % RING][k] = xr[k];
+                ref_im[j % RING][k] = (FFT_REAL && k == 0) ? xr[FFT_SIZE] : xi[k];   // Nyquist in bin 0
+            }
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, 0, frames);
+
+        for (int t = 0; t < frames; t++) {
+            const int j = c * FFT_TB_BENCH_BATCH + t - FFT_FRAME_LATENCY;   // input of this output
+            for (int b = 0; b < FFT_BEATS; b++) {
+                axis_t result = out_stream.read();
+                if (result.last != ((b == FFT_BEATS - 1) ? 1 : 0)) tlast_error = 1;
+                if (j < 0) continue;
+                double scale = 1.0;
+#if FFT_BFP
+                scale = ldexp(1.0, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+                for (int l = 0; l < FFT_SSR; l++) {
+                    int     k = output_bin(b * FFT_SSR + l);
+                    fixed_t r, im;
+                    unpack_lane(result.data, l, r, im);
+                    double er  = r.to_double() * scale - ref_re[j % RING][k];
+                    double ei  = im.to_double() * scale - ref_im[j % RING][k];
+                    int    cls = j % BENCH_CLASSES;
+                    sig[cls]  += ref_re[j % RING][k] * ref_re[j % RING][k]
+                               + ref_im[j % RING][k] * ref_im[j % RING][k];
+                    noise[cls] += er * er + ei * ei;
+                    max_err[cls] = fmax(max_err[cls], fmax(fabs(er), fabs(ei)));
+                }
+            }
+        }
+    }
+
+    printf("Accuracy benchmark (%d frames, batches of %d, pass >= %.1f dB):\n",
+           CALLS * FFT_TB_BENCH_BATCH, FFT_TB_BENCH_BATCH, (double)FFT_TB_MIN_SQNR);
+    for (int cls = 0; cls < BENCH_CLASSES; cls++) {
+        double sqnr = 10.0 * log10(sig[cls] / fmax(noise[cls], 1e-300));
+        bool   ok   = sqnr >= FFT_TB_MIN_SQNR;
+        printf("  %-10s SQNR %6.1f dB  max err %.3g  %s\n", class_name[cls], sqnr, max_err[cls],
+               ok ? "PASS" : "FAIL");
+        if (!ok) error = 1;
+    }
+    printf("  TLAST framing:                      %s\n", tlast_error ? "FAIL" : "PASS");
+    return error || tlast_error;
+}
+
+#if FFT_FASTCONV
+/**
+ * @brief Overlap-save FIR: one primed full frame, then a batch of hops
+ *
+ * The M = FFT_SIZE / 4 + 1 taps fall linearly (sum 1, so |H| <= 1) and are
+ * asymmetric, so a time-reversed or conjugated response would show. The
+ * first call reads a whole frame whose first FFT_SIZE - hop samples are
+ * zero, which fills the history; its last hop outputs are y[0 .. hop-1].
+ * Returns 1 if any output is off the direct convolution.
+ */
+static int fastconv_check(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream) {
+    const int M      = FFT_SIZE / 4 + 1;
+    const int HOP    = FFT_SIZE - M + 1;
+    const int FRAMES = 3;
+    const int LEN    = FFT_SIZE - HOP + HOP * (1 + FRAMES);   // zero lead-in + signal
+    static fixed_t x_re[LEN], x_im[LEN];
+    static double  h[M];
+    int error = 0;
+
+    for (int m = 0; m < M; m++) {
+        h[m] = 2.0 * (M - m) / ((double)M * (M + 1));
+    }
+    for (int k = 0; k < FFT_SIZE; k++) {
+        double hr = 0.0, hi = 0.0;
+        for (int m = 0; m < M; m++) {
+            hr += h[m] * cos(2.0 * M_PI * k * m / FFT_SIZE);
+            hi -= h[m] * sin(2.0 * M_PI * k * m / FFT_SIZE);
+        }
+        filter_t qr = hr, qi = hi;
+        filter_ram[k] = ((filter_word_t)qr.range() << 16) | (filter_word_t)(ap_uint<16>)qi.range();
+    }
+    srand(1);
+    for (int n = 0; n < LEN; n++) {
+        bool lead = n < FFT_SIZE - HOP;
+        x_re[n] = lead ? 0.0 : rand() / (double)RAND_MAX - 0.5;
+        x_im[n] = lead ? 0.0 : rand() / (double)RAND_MAX - 0.5;
+    }
+
+    send_samples(in_stream, x_re, x_im, LEN, 0, FFT_SIZE);
+    run_fft(in_stream, out_stream, FFT_SIZE, 0, 1, 0);
+    for (int i = 0; i < FFT_SIZE - HOP; i++) {
+        out_stream.read();   // circular wrap of the priming frame
+    }
+    for (int f = 0; f < FRAMES; f++) {
+        send_samples(in_stream, x_re, x_im, LEN, FFT_SIZE + f * HOP, HOP);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, 0, FRAMES, HOP);
+
+    double max_err = 0.0;
+    for (int i = 0; i < HOP * (1 + FRAMES); i++) {
+        const int n = FFT_SIZE - HOP + i;   // input index of output i
+        double yr = 0.0, yi = 0.0;
+        for (int m = 0; m < M; m++) {
+            yr += h[m] * x_re[n - m].to_double();
+            yi += h[m] * x_im[n - m].to_double();
+        }
+        axis_t result = out_stream.read();
+        if (result.last != ((i % HOP == HOP - 1) ? 1 : 0)) {
+            printf("ERROR: fast convolution TLAST wrong at output %d\n", i);
+            error = 1;
+        }
+        fixed_t re, im;
+        unpack_data(result.data, re, im);
+        double sc = 1.0;
+#if FFT_BFP
+        sc = ldexp(1.0, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+        double err = fmax(fabs(re.to_double() * sc - yr), fabs(im.to_double() * sc - yi));
+        max_err = fmax(max_err, err);
+    }
+    // A few LSBs of the datapath after two transforms
+    const double tol = ldexp(16.0, -(FFT_DATA_W - FFT_DATA_I));
+    if (max_err > tol || !out_stream.empty()) {
+        printf("ERROR: fast convolution max error %.6f\n", max_err);
+        error = 1;
+    }
+    printf("Fast convolution (%d taps):  %s (max err=%.6f)\n", M, error ? "FAIL" : "PASS", max_err);
+    return error;
+}
+#endif
+
+#if FFT_PFB_TAPS
+/**
+ * @brief PFB channelizer: prototype load, then a batch of filtered frames
+ *
+ * The prototype is a Hann-weighted sinc over M * FFT_SIZE taps with the
+ * channel spacing as cutoff, written branch by branch to the PFB RAM. One
+ * batch of M - 1 + 3 random blocks loads the branches and fills the
+ * history; its last 3 spectra must match the FFT of the polyphase sums of
+ * the quantised taps. Returns 1 on a mismatch.
+ */
+static int pfb_check(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream) {
+    const int M      = FFT_PFB_TAPS;
+    const int N      = FFT_SIZE;
+    const int FRAMES = M - 1 + 3;
+    static double  h[M * N];
+    static fixed_t x_re[FRAMES * N], x_im[FRAMES * N];
+    static double  y_re[N], y_im[N];
+    int error = 0;
+
+    for (int k = 0; k < M * N; k++) {
+        double t    = (k - (M * N - 1) / 2.0) / N;
+        double hann = 0.5 - 0.5 * cos(2.0 * M_PI * (k + 0.5) / (M * N));
+        h[k] = ((pfb_coef_t)(hann * sin(M_PI * t) / (M_PI * t))).to_double();
+    }
+    for (int m = 0; m < M; m++) {
+        for (int w = 0; w < N / 2; w++) {
+            pfb_coef_t c0 = h[m * N + 2 * w], c1 = h[m * N + 2 * w + 1];
+            pfb_ram[m * N / 2 + w] = ((pfb_word_t)(ap_uint<16>)c1.range() << 16) |
+                                     (pfb_word_t)(ap_uint<16>)c0.range();
+        }
+    }
+    srand(2);
+    for (int n = 0; n < FRAMES * N; n++) {
+        x_re[n] = rand() / (double)RAND_MAX - 0.5;
+        x_im[n] = rand() / (double)RAND_MAX - 0.5;
+        axis_t beat;
+        pack_lane(beat.data, 0, x_re[n], x_im[n]);
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (n % N == N - 1) ? 1 : 0;
+        in_stream.write(beat);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_PFB | FFT_CTRL_PFB_LOAD, FRAMES);
+
+    double max_err = 0.0;
+    for (int t = 0; t < FRAMES; t++) {
+        // Frames before M - 1 also fold in blocks of the earlier checks
+        const bool checked = t >= M - 1;
+        if (checked) {
+            for (int n = 0; n < N; n++) {
+                y_re[n] = 0.0;
+                y_im[n] = 0.0;
+                for (int m = 0; m < M; m++) {
+                    y_re[n] += h[m * N + n] * x_re[(t - M + 1 + m) * N + n].to_double();
+                    y_im[n] += h[m * N + n] * x_im[(t - M + 1 + m) * N + n].to_double();
+                }
+            }
+            ref_fft(y_re, y_im, N);
+        }
+        for (int k = 0; k < N; k++) {
+            axis_t result = out_stream.read();
+            if (!checked) continue;
+            fixed_t re, im;
+            unpack_data(result.data, re, im);
+            double sc = 1.0;
+#if FFT_BFP
+            sc = ldexp(1.0, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+            double err = fmax(fabs(re.to_double() * sc - y_re[k]), fabs(im.to_double() * sc - y_im[k]));
+            max_err = fmax(max_err, err);
+        }
+    }
+    // Rounding of the polyphase sum and of log2(N) stages
+    const double tol = ldexp(4.0 * N, -(FFT_DATA_W - FFT_DATA_I));
+    if (max_err > tol) {
+        printf("ERROR: PFB max error %.6f\n", max_err);
+        error = 1;
+    }
+    printf("PFB channelizer (%d taps):   %s (max err=%.6f)\n", M, error ? "FAIL" : "PASS", max_err);
+    return error;
+}
+#endif
+
+#if FFT_PEAKS
+/**
+ * @brief Peak records of a frame with three tones of distinct power
+ *
+ * Without a threshold all FFT_PEAKS records are valid, sorted by power,
+ * and lead with the tones; with a threshold below the weakest tone only
+ * the tones are reported and the other records are vacant. Every frame
+ * is exactly FFT_PEAKS beats with TLAST on the last. Returns 1 on a
+ * mismatch.
+ */
+static int peak_check(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream) {
+    const int    N = FFT_SIZE;
+    const int    T = 3;
+    const int    bins[T] = {N / 2 + 5, N / 4 + 3, N / 8 + 1};
+    const double amps[T] = {0.5, 0.3, 0.15};
+    const int    expect  = (FFT_PEAKS < T) ? FFT_PEAKS : T;
+    int error = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        // Bin power (A * N)^2 for a complex tone; a real cosine over 2N points has the same
+        const float thresh = pass ? (float)(0.5 * pow(amps[T - 1] * N, 2)) : 0.0f;
+        for (int n = 0; n < N; n++) {
+            double re = 0.0, im = 0.0;
+            for (int t = 0; t < T; t++) {
+#if FFT_REAL
+                re += amps[t] * cos(2.0 * M_PI * bins[t] * (2 * n) / (2 * N));
+                im += amps[t] * cos(2.0 * M_PI * bins[t] * (2 * n + 1) / (2 * N));
+#else
+                re += amps[t] * cos(2.0 * M_PI * bins[t] * n / N);
+                im += amps[t] * sin(2.0 * M_PI * bins[t] * n / N);
+#endif
+            }
+            axis_t beat;
+            pack_lane(beat.data, 0, re, im);
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (n == N - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_PEAKS, 1, 0, 0, thresh);
+
+        float prev = INFINITY;
+        for (int j = 0; j < FFT_PEAKS; j++) {
+            axis_t result = out_stream.read();
+            float power;
+            ap_uint<32> bin;
+            unpack_peak(result.data, power, bin);
+            bool ok = (result.last == 1) == (j == FFT_PEAKS - 1) && power <= prev;
+            if (j < expect) {
+                double want = pow(amps[j] * N, 2);
+                ok = ok && bin == (unsigned)bins[j] && fabs(power - want) < 1e-2 * want;
+            } else if (pass) {
+                ok = ok && bin == FFT_PEAK_NONE && power == 0.0f;
+            } else {
+                ok = ok && bin != FFT_PEAK_NONE && bin < (unsigned)N;
+            }
+            if (!ok) {
+                printf("ERROR: peak record %d (thresh %g): bin %u power %g\n", j, thresh, bin.to_uint(), power);
+                error = 1;
+            }
+            prev = power;
+        }
+        if (!out_stream.empty()) {
+            printf("ERROR: more than %d peak records\n", FFT_PEAKS);
+            error = 1;
+            while (!out_stream.empty()) out_stream.read();
+        }
+    }
+    printf("Peak records (K=%d):          %s\n", FFT_PEAKS, error ? "FAIL" : "PASS");
+    return error;
+}
+#endif
+
+/**
+ * @brief Host frame sizing against the words the IP reads
+ *
+ * For every length and hop register value, one frame of
+ * fft_frame_words(len, hop) words must be consumed exactly: an IP that
+ * reads more aborts on the empty stream, one that reads fewer leaves
+ * words behind. Returns 1 on a mismatch.
+ */
+static int host_sizing_check(hls::stream<axis_t> &in_stream, hls::stream<axis_t> &out_stream) {
+    const unsigned lens[] = {0, 8, 16, 1000, FFT_SIZE / 2 + 1, FFT_SIZE, 2 * FFT_SIZE - 1, 2 * FFT_SIZE};
+#if FFT_STFT
+    const unsigned hops[] = {0, 1, 3 * FFT_SSR + 1, FFT_SIZE / 4, FFT_SIZE, FFT_SIZE + 1, 2 * FFT_SIZE + 8};
+#else
+    const unsigned hops[] = {0};
+#endif
+    int error = 0;
+    for (unsigned len : lens) {
+        for (unsigned hop : hops) {
+            const int words = (int)fft_frame_words(len, hop);
+            for (int b = 0; b < words / FFT_SSR; b++) {
+                axis_t beat;
+                beat.data = 0;
+                beat.keep = -1;
+                beat.strb = -1;
+                beat.last = (b == words / FFT_SSR - 1) ? 1 : 0;
+                in_stream.write(beat);
+            }
+            run_fft(in_stream, out_stream, (fft_len_t)len, 0, 1, (fft_hop_t)hop);
+            if (!in_stream.empty()) {
+                printf("ERROR: len %u hop %u: host sends %d words, IP read fewer\n", len, hop, words);
+                error = 1;
+                while (!in_stream.empty()) in_stream.read();
+            }
+            while (!out_stream.read().last) {}
+        }
+    }
+    printf("Host frame sizing:           %s\n", error ? "FAIL" : "PASS");
+    return error;
+}
+
 int main() {
     /* ---- Configuration ---- */
-    const int TONE1 = 10;   // First tone: 10 cycles in 256 samples
-    const int TONE2 = 30;   // Second tone: 30 cycles in 256 samples
+    const int TONE1 = (FFT_SIZE >= 64) ? 10 : 2;   // First tone: cycles per frame
+    const int TONE2 = (FFT_SIZE >= 64) ? 30 : 5;   // Second tone: cycles per frame
 
     hls::stream<axis_t> in_stream("in_stream");
     hls::stream<axis_t> out_stream("out_stream");
 
+#if FFT_FASTCONV
+    // The IP is an overlap-save filter in this build, not a spectrum engine
+    int conv_error = fastconv_check(in_stream, out_stream);
+    printf("\n=== TEST %s ===\n", conv_error ? "FAILED" : "PASSED");
+    return conv_error;
+#endif
+
     /* ================================================================
      *  Generate Dual-Tone Sine Wave Input
      * ================================================================ */
-    printf("=== 256-Point FFT Testbench ===\n");
+    printf("=== %d-Point FFT Testbench ===\n", FFT_SIZE);
     printf("Input: dual-tone sine wave (f1=%d, f2=%d)\n\n", TONE1, TONE2);
 
+    fixed_t in_real[FFT_SIZE], in_imag[FFT_SIZE];
+#if FFT_REAL
+    // Real mode: word n carries x[2n] and x[2n+1] of a 2N-point frame
+    for (int n = 0; n < FFT_SIZE; n++) {
+        in_real[n] = (fixed_t)(sin(2.0 * M_PI * TONE1 * (2 * n) / (2 * FFT_SIZE))
+                             + sin(2.0 * M_PI * TONE2 * (2 * n) / (2 * FFT_SIZE)));
+        in_imag[n] = (fixed_t)(sin(2.0 * M_PI * TONE1 * (2 * n + 1) / (2 * FFT_SIZE))
+                             + sin(2.0 * M_PI * TONE2 * (2 * n + 1) / (2 * FFT_SIZE)));
+    }
+    const int SPEC_BINS = FFT_SIZE;       // non-redundant bins returned
+#else
     for (int n = 0; n < FFT_SIZE; n++) {
         // Dual-tone: x[n] = sin(2*pi*f1*n/N) + sin(2*pi*f2*n/N)
         double val = sin(2.0 * M_PI * TONE1 * n / FFT_SIZE)
                    + sin(2.0 * M_PI * TONE2 * n / FFT_SIZE);
 
-        fixed_t real_val = (fixed_t)val;
-        fixed_t imag_val = (fixed_t)0.0;
+        in_real[n] = (fixed_t)val;
+        in_imag[n] = (fixed_t)0.0;
+    }
+    const int SPEC_BINS = FFT_SIZE / 2;   // first half, the rest mirrors it
+#endif
 
-        axis_t sample;
-        sample.data = pack_data(real_val, imag_val);
-        sample.keep = -1;
-        sample.strb = -1;
-        sample.last = (n == FFT_SIZE - 1) ? 1 : 0;
+    // FFT_SSR consecutive samples per beat, TLAST on the last beat
+    for (int b = 0; b < FFT_BEATS; b++) {
+        axis_t beat;
+        for (int l = 0; l < FFT_SSR; l++) {
+            pack_lane(beat.data, l, in_real[b * FFT_SSR + l], in_imag[b * FFT_SSR + l]);
+        }
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
 
-        in_stream.write(sample);
+        in_stream.write(beat);
     }
 
     /* ================================================================
      *  Run FFT
      * ================================================================ */
     printf("Running FFT ...\n");
-    fft(in_stream, out_stream);
+    run_fft(in_stream, out_stream, FFT_SIZE, 0);
+
+    // Streaming engines return the spectrum FFT_FRAME_LATENCY calls later:
+    // push zero frames to flush it out and drop the outputs that precede it.
+    for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t beat;
+            for (int l = 0; l < FFT_SSR; l++) {
+                pack_lane(beat.data, l, (fixed_t)0.0, (fixed_t)0.0);
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, 0);
+    }
+    for (int i = 0; i < FFT_FRAME_LATENCY * FFT_BEATS; i++) {
+        out_stream.read();
+    }
     printf("FFT completed.\n\n");
 
     /* ================================================================
@@ -64,25 +684,34 @@ int main() {
     float real_out[FFT_SIZE], imag_out[FFT_SIZE];
     int   tlast_error = 0;
 
-    for (int i = 0; i < FFT_SIZE; i++) {
+    for (int b = 0; b < FFT_BEATS; b++) {
         axis_t result = out_stream.read();
 
-        fixed_t r, im;
-        unpack_data(result.data, r, im);
+        // Block floating point: spectrum = output * 2^TUSER
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+
+        for (int l = 0; l < FFT_SSR; l++) {
+            int i = output_bin(b * FFT_SSR + l);
+            fixed_t r, im;
+            unpack_lane(result.data, l, r, im);
 
-        real_out[i]  = (float)r;
-        imag_out[i]  = (float)im;
-        magnitude[i] = sqrtf(real_out[i] * real_out[i] + imag_out[i] * imag_out[i]);
+            real_out[i]  = (float)r * scale;
+            imag_out[i]  = (float)im * scale;
+            magnitude[i] = sqrtf(real_out[i] * real_out[i] + imag_out[i] * imag_out[i]);
+        }
 
-        // Check TLAST: must be 1 only on last sample
-        if (i == FFT_SIZE - 1) {
+        // Check TLAST: must be 1 only on last beat
+        if (b == FFT_BEATS - 1) {
             if (result.last != 1) {
-                printf("ERROR: TLAST not asserted on last sample (index %d)!\n", i);
+                printf("ERROR: TLAST not asserted on last beat (index %d)!\n", b);
                 tlast_error = 1;
             }
         } else {
             if (result.last != 0) {
-                printf("ERROR: TLAST asserted on non-last sample (index %d)!\n", i);
+                printf("ERROR: TLAST asserted on non-last beat (index %d)!\n", b);
                 tlast_error = 1;
             }
         }
@@ -91,10 +720,10 @@ int main() {
     /* ================================================================
      *  Print Magnitude Spectrum
      * ================================================================ */
-    printf("Magnitude Spectrum (first half):\n");
+    printf("Magnitude Spectrum (%d bins):\n", SPEC_BINS);
     printf("%-6s  %-14s\n", "Bin", "Magnitude");
     printf("------  --------------\n");
-    for (int i = 0; i < FFT_SIZE / 2; i++) {
+    for (int i = 0; i < SPEC_BINS; i++) {
         printf("[%3d]   %12.4f", i, magnitude[i]);
         if (i == TONE1 || i == TONE2) {
             printf("  <-- expected peak (f=%d)", i);
@@ -119,29 +748,849 @@ int main() {
     bool peak_f1 = (magnitude[TONE1] > threshold);
     bool peak_f2 = (magnitude[TONE2] > threshold);
 
+#if !FFT_REAL
     // Check mirror peaks (N-f)
     bool peak_f1_mirror = (magnitude[FFT_SIZE - TONE1] > threshold);
     bool peak_f2_mirror = (magnitude[FFT_SIZE - TONE2] > threshold);
+#endif
 
     // Count unexpected peaks in first half (excluding DC)
     int unexpected_peaks = 0;
-    for (int i = 1; i < FFT_SIZE / 2; i++) {
+    for (int i = 1; i < SPEC_BINS; i++) {
         if (i != TONE1 && i != TONE2 && magnitude[i] > threshold) {
             printf("WARNING: Unexpected peak at bin %d (magnitude=%.4f)\n", i, magnitude[i]);
             unexpected_peaks++;
         }
     }
 
+    /* ================================================================
+     *  Short Frame via Runtime Length Register
+     * ================================================================ */
+    int short_error = 0;
+#if FFT_ENGINE != FFT_ENGINE_SDF
+    const int SHORT_LEN  = 16;
+    const int SHORT_TONE = 3;
+    for (int n = 0; n < SHORT_LEN; n++) {
+        axis_t beat;
+#if FFT_REAL
+        pack_lane(beat.data, 0, (fixed_t)cos(2.0 * M_PI * SHORT_TONE * (2 * n) / (2 * SHORT_LEN)),
+                                (fixed_t)cos(2.0 * M_PI * SHORT_TONE * (2 * n + 1) / (2 * SHORT_LEN)));
+#else
+        pack_lane(beat.data, 0, (fixed_t)cos(2.0 * M_PI * SHORT_TONE * n / SHORT_LEN), (fixed_t)0.0);
+#endif
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (n == SHORT_LEN - 1) ? 1 : 0;
+        in_stream.write(beat);
+    }
+    run_fft(in_stream, out_stream, SHORT_LEN, 0);
+
+    for (int i = 0; i < SHORT_LEN; i++) {
+        axis_t result = out_stream.read();
+        fixed_t r, im;
+        unpack_lane(result.data, 0, r, im);
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+#if FFT_REAL
+        // 2*SHORT_LEN real points: SHORT_LEN at bin SHORT_TONE only
+        float expect = (i == SHORT_TONE) ? (float)SHORT_LEN : 0.0f;
+#else
+        // cos tone: SHORT_LEN/2 at bins SHORT_TONE and SHORT_LEN-SHORT_TONE, 0 elsewhere
+        float expect = (i == SHORT_TONE || i == SHORT_LEN - SHORT_TONE) ? SHORT_LEN / 2.0f : 0.0f;
+#endif
+        float mag    = sqrtf((float)r * (float)r + (float)im * (float)im) * scale;
+        if (fabsf(mag - expect) > 0.01f * SHORT_LEN / 2) {   // 1% of the complex tone peak
+            printf("ERROR: %d-point bin %d magnitude %.4f, expected %.4f\n", SHORT_LEN, i, mag, expect);
+            short_error = 1;
+        }
+        if (result.last != ((i == SHORT_LEN - 1) ? 1 : 0)) {
+            printf("ERROR: %d-point TLAST wrong at index %d\n", SHORT_LEN, i);
+            short_error = 1;
+        }
+    }
+    printf("%d-point short frame:         %s\n", SHORT_LEN, short_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Inverse Round Trip: IFFT(FFT(x)) / N == x
+     * ================================================================ */
+    int inverse_error = 0;
+#if !FFT_REAL   // real-mode spectra are half spectra; inverse frames are complex
+    float max_inv_err = 0.0f;
+    for (int f = 0; f <= FFT_FRAME_LATENCY; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t beat;
+            for (int l = 0; l < FFT_SSR; l++) {
+                int i = b * FFT_SSR + l;
+                pack_lane(beat.data, l, (fixed_t)((f == 0) ? real_out[i] : 0.0f),
+                                        (fixed_t)((f == 0) ? imag_out[i] : 0.0f));
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_INVERSE | FFT_CTRL_SCALE);
+    }
+    for (int i = 0; i < FFT_FRAME_LATENCY * FFT_BEATS; i++) {
+        out_stream.read();
+    }
+    for (int b = 0; b < FFT_BEATS; b++) {
+        axis_t result = out_stream.read();
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+        for (int l = 0; l < FFT_SSR; l++) {
+            int i = output_bin(b * FFT_SSR + l);
+            fixed_t r, im;
+            unpack_lane(result.data, l, r, im);
+            float err = fmaxf(fabsf((float)r * scale - (float)in_real[i]),
+                              fabsf((float)im * scale - (float)in_imag[i]));
+            if (err > max_inv_err) max_inv_err = err;
+        }
+    }
+    if (max_inv_err > 0.02f) {   // 1% of the dual-tone peak
+        printf("ERROR: inverse round trip error %.4f\n", max_inv_err);
+        inverse_error = 1;
+    }
+#endif
+
+    /* ================================================================
+     *  Bit-Reversed Chain: FFT (bit-reversed out) -> IFFT (bit-reversed in)
+     * ================================================================ */
+    int order_error = 0;
+#if FFT_ENGINE != FFT_ENGINE_SDF && !FFT_REAL
+    fixed_t chain_re[FFT_SIZE], chain_im[FFT_SIZE];
+    for (int n = 0; n < FFT_SIZE; n++) {
+        axis_t beat;
+        pack_lane(beat.data, 0, in_real[n], in_imag[n]);
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (n == FFT_SIZE - 1) ? 1 : 0;
+        in_stream.write(beat);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_BITREV_OUT);
+    for (int i = 0; i < FFT_SIZE; i++) {
+        axis_t result = out_stream.read();
+        fixed_t r, im;
+        unpack_lane(result.data, 0, r, im);
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+        int bin = 0;
+        for (int b = 0; b < LOG2_FFT_SIZE; b++) {
+            bin |= ((i >> b) & 1) << (LOG2_FFT_SIZE - 1 - b);
+        }
+        if (fabsf((float)r * scale - real_out[bin]) > 0.01f || fabsf((float)im * scale - imag_out[bin]) > 0.01f) {
+            printf("ERROR: bit-reversed output %d does not hold bin %d\n", i, bin);
+            order_error = 1;
+        }
+        chain_re[i] = (fixed_t)((float)r * scale);
+        chain_im[i] = (fixed_t)((float)im * scale);
+    }
+    for (int i = 0; i < FFT_SIZE; i++) {
+        axis_t beat;
+        pack_lane(beat.data, 0, chain_re[i], chain_im[i]);
+        beat.keep = -1;
+        beat.strb = -1;
+        beat.last = (i == FFT_SIZE - 1) ? 1 : 0;
+        in_stream.write(beat);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_BITREV_IN | FFT_CTRL_INVERSE | FFT_CTRL_SCALE);
+    for (int n = 0; n < FFT_SIZE; n++) {
+        axis_t result = out_stream.read();
+        fixed_t r, im;
+        unpack_lane(result.data, 0, r, im);
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+        if (fmaxf(fabsf((float)r * scale - (float)in_real[n]),
+                  fabsf((float)im * scale - (float)in_imag[n])) > 0.02f) {
+            printf("ERROR: bit-reversed chain sample %d mismatch\n", n);
+            order_error = 1;
+        }
+    }
+    printf("Bit-reversed chain:          %s\n", order_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Half Spectrum and Scalar Output Formats
+     * ================================================================ */
+    int format_error = 0;
+    const fft_ctrl_t FORMATS[] = {
+        FFT_CTRL_HALF,
+#if FFT_SCALAR_OUT
+        FFT_CTRL_FMT_POWER, FFT_CTRL_FMT_MAG, FFT_CTRL_FMT_DB,
+        FFT_CTRL_FMT_MAG | FFT_CTRL_HALF,
+#endif
+    };
+    for (unsigned t = 0; t < sizeof(FORMATS) / sizeof(FORMATS[0]); t++) {
+        const fft_ctrl_t ctrl = FORMATS[t];
+        const fft_ctrl_t fmt  = ctrl & FFT_CTRL_FORMAT;
+        const int n_bins = (ctrl & FFT_CTRL_HALF) ? FFT_SIZE / 2 : FFT_SIZE;
+        const int n_beats = (fmt == FFT_CTRL_FMT_COMPLEX) ? n_bins / FFT_SSR : n_bins / (2 * FFT_SSR);
+        for (int f = 0; f <= FFT_FRAME_LATENCY; f++) {
+            for (int b = 0; b < FFT_BEATS; b++) {
+                axis_t beat;
+                for (int l = 0; l < FFT_SSR; l++) {
+                    int i = b * FFT_SSR + l;
+                    pack_lane(beat.data, l, (f == 0) ? in_real[i] : (fixed_t)0.0,
+                                            (f == 0) ? in_imag[i] : (fixed_t)0.0);
+                }
+                beat.keep = -1;
+                beat.strb = -1;
+                beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+                in_stream.write(beat);
+            }
+            run_fft(in_stream, out_stream, FFT_SIZE, ctrl);
+        }
+        // Drop the frames still in flight (their length depends on their own ctrl)
+        for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+            while (!out_stream.read().last) {}
+        }
+        for (int b = 0; b < n_beats; b++) {
+            axis_t result = out_stream.read();
+            if (result.last != ((b == n_beats - 1) ? 1 : 0)) {
+                printf("ERROR: format 0x%02x TLAST wrong at beat %d\n", (int)ctrl, b);
+                format_error = 1;
+            }
+            float scale = 1.0f;
+#if FFT_BFP
+            scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+            for (int l = 0; l < FFT_SSR; l++) {
+                float got[2], expect_re[2], expect_im[2];
+                int   n_got = 1;
+                if (fmt == FFT_CTRL_FMT_COMPLEX) {
+                    fixed_t r, im;
+                    unpack_lane(result.data, l, r, im);
+                    got[0] = (float)r * scale;   // real part; imaginary checked below
+                    expect_re[0] = real_out[output_bin(b * FFT_SSR + l)];
+                    expect_im[0] = imag_out[output_bin(b * FFT_SSR + l)];
+                    if (fabsf((float)im * scale - expect_im[0]) > 1e-3f * max_mag) {
+                        printf("ERROR: half-spectrum bin %d imaginary part\n", output_bin(b * FFT_SSR + l));
+                        format_error = 1;
+                    }
+                } else {
+                    unpack_scalars(result.data, l, got[0], got[1]);
+                    n_got = 2;
+                    for (int h = 0; h < 2; h++) {
+                        int k = output_bin(2 * (b * FFT_SSR + l) + h);
+                        expect_re[h] = real_out[k];
+                        expect_im[h] = (FFT_REAL && k == 0) ? 0.0f : imag_out[k];   // DC without Nyquist
+                    }
+                }
+                for (int h = 0; h < n_got; h++) {
+                    int   k    = output_bin((n_got == 2) ? 2 * (b * FFT_SSR + l) + h : b * FFT_SSR + l);
+                    float pow_ = expect_re[h] * expect_re[h] + expect_im[h] * expect_im[h];
+                    float mag_ = sqrtf(pow_);
+                    float err  = 0.0f;
+                    if (fmt == FFT_CTRL_FMT_COMPLEX)    err = fabsf(got[h] - expect_re[h]) / max_mag;
+                    else if (fmt == FFT_CTRL_FMT_POWER) err = fabsf(got[h] - pow_) / (max_mag * max_mag);
+                    else if (fmt == FFT_CTRL_FMT_MAG)   err = fabsf(got[h] - mag_) / max_mag;
+                    else if (mag_ > 0.01f * max_mag)    err = fabsf(got[h] - 20.0f * log10f(mag_)) / 100.0f;
+                    if (err > 1e-3f) {   // 0.1% of full scale (0.1 dB for dB)
+                        printf("ERROR: format 0x%02x bin %d = %.4f\n", (int)ctrl, k, got[h]);
+                        format_error = 1;
+                    }
+                }
+            }
+        }
+    }
+    printf("Half spectrum / formats:     %s\n", format_error ? "FAIL" : "PASS");
+
+    /* ================================================================
+     *  Input Window: DFT(w) of a periodic cosine-sum window
+     * ================================================================ */
+    int window_error = 0;
+#if FFT_WINDOW != FFT_WINDOW_NONE
+    // a0 - a1 cos + a2 cos2 - a3 cos3: bin k = (-1)^k a_k / 2 * len, bin 0 = a0 * len
+    const double WIN_A[4] =
+#if FFT_WINDOW == FFT_WINDOW_HAMMING
+        {0.54, 0.46, 0.0, 0.0};
+#elif FFT_WINDOW == FFT_WINDOW_BLACKMAN_HARRIS
+        {0.35875, 0.48829, 0.14128, 0.01168};
+#else   // Hann, also loaded into the RAM
+        {0.5, 0.5, 0.0, 0.0};
+#endif
+    const int WIN_LEN = FFT_WINDOW_LEN;
+#if FFT_WINDOW == FFT_WINDOW_RAM
+    for (int m = 0; m < WIN_LEN / 2; m++) {
+        window_t w0 = (window_t)(0.5 - 0.5 * cos(2.0 * M_PI * (2 * m) / WIN_LEN));
+        window_t w1 = (window_t)(0.5 - 0.5 * cos(2.0 * M_PI * (2 * m + 1) / WIN_LEN));
+        window_ram[m] = ((window_word_t)w1.range() << 16) | (window_word_t)w0.range();
+    }
+#endif
+    for (int f = 0; f <= FFT_FRAME_LATENCY; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t beat;
+            for (int l = 0; l < FFT_SSR; l++) {
+                fixed_t one = (f == 0) ? 1.0 : 0.0;
+                pack_lane(beat.data, l, one, FFT_REAL ? one : (fixed_t)0.0);
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_WINDOW);
+    }
+    // Frames still in flight from the format test may be half length
+    for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+        while (!out_stream.read().last) {}
+    }
+    for (int b = 0; b < FFT_BEATS; b++) {
+        axis_t result = out_stream.read();
+        float scale = 1.0f;
+#if FFT_BFP
+        scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+        for (int l = 0; l < FFT_SSR; l++) {
+            int k = output_bin(b * FFT_SSR + l);
+            fixed_t r, im;
+            unpack_lane(result.data, l, r, im);
+            int d = (k < FFT_SIZE / 2) ? k : k - FFT_SIZE;   // signed bin
+            if (FFT_REAL) d = k;                              // half spectrum
+            double expect_re = 0.0;
+            if (d == 0)              expect_re = WIN_A[0] * WIN_LEN;
+            else if (abs(d) <= 3)    expect_re = ((abs(d) & 1) ? -1.0 : 1.0) * WIN_A[abs(d)] / 2 * WIN_LEN;
+            double err = fmax(fabs((float)r * scale - expect_re), fabs((float)im * scale));
+            if (err > 0.01 * WIN_A[0] * WIN_LEN) {   // 1% of the DC bin
+                printf("ERROR: windowed bin %d = (%.4f, %.4f), expected %.4f\n",
+                       k, (float)r * scale, (float)im * scale, expect_re);
+                window_error = 1;
+            }
+        }
+    }
+    printf("Input window:                %s\n", window_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Batch Mode: several frames per call
+     * ================================================================ */
+    // BATCH frames of the dual-tone input, then FFT_FRAME_LATENCY zero frames
+    // that push them out of a streaming engine. The first call has a TLAST
+    // per frame; the second one TLAST for the whole batch, so its leading
+    // outputs (the zero frames of the first call) carry none.
+    int batch_error = 0;
+    const int BATCH  = 3;
+    const int FRAMES = BATCH + FFT_FRAME_LATENCY;
+    for (int pass = 0; pass < 2; pass++) {
+        const fft_ctrl_t ctrl = pass ? FFT_CTRL_BATCH_TLAST : 0;
+        for (int f = 0; f < FRAMES; f++) {
+            for (int b = 0; b < FFT_BEATS; b++) {
+                axis_t beat;
+                for (int l = 0; l < FFT_SSR; l++) {
+                    int n = b * FFT_SSR + l;
+                    pack_lane(beat.data, l, (f < BATCH) ? in_real[n] : (fixed_t)0.0,
+                                            (f < BATCH) ? in_imag[n] : (fixed_t)0.0);
+                }
+                beat.keep = -1;
+                beat.strb = -1;
+                beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+                in_stream.write(beat);
+            }
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, ctrl, FRAMES);
+
+        // Frames still in flight from earlier calls may use another format
+        for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+            if (pass) {
+                for (int b = 0; b < FFT_BEATS; b++) {
+                    if (out_stream.read().last) batch_error = 1;
+                }
+            } else {
+                while (!out_stream.read().last) {}
+            }
+        }
+        for (int f = 0; f < BATCH; f++) {
+            for (int b = 0; b < FFT_BEATS; b++) {
+                axis_t result = out_stream.read();
+                bool last_expected = (b == FFT_BEATS - 1) && (!pass || f == BATCH - 1);
+                if ((result.last == 1) != last_expected) {
+                    printf("ERROR: batch %d frame %d beat %d TLAST = %d\n", pass, f, b, (int)result.last);
+                    batch_error = 1;
+                }
+                float scale = 1.0f;
+#if FFT_BFP
+                scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+                for (int l = 0; l < FFT_SSR; l++) {
+                    int k = output_bin(b * FFT_SSR + l);
+                    fixed_t r, im;
+                    unpack_lane(result.data, l, r, im);
+                    if (fabsf((float)r * scale - real_out[k]) > 0.01f || fabsf((float)im * scale - imag_out[k]) > 0.01f) {
+                        printf("ERROR: batch %d frame %d bin %d mismatch\n", pass, f, k);
+                        batch_error = 1;
+                    }
+                }
+            }
+        }
+    }
+    // Leave no zero frames behind with a batch ctrl
+    for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t beat;
+            for (int l = 0; l < FFT_SSR; l++) {
+                pack_lane(beat.data, l, (fixed_t)0.0, (fixed_t)0.0);
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, 0);
+    }
+    for (int i = 0; i < FFT_FRAME_LATENCY * FFT_BEATS; i++) {
+        out_stream.read();
+    }
+    printf("Batch mode:                  %s\n", batch_error ? "FAIL" : "PASS");
+
+    /* ================================================================
+     *  STFT: overlapped frames from the history vs. duplicated input
+     * ================================================================ */
+    int stft_error = 0;
+#if FFT_STFT
+    // Frame k covers samples k * HOP .. k * HOP + N - 1 of one long signal.
+    // The reference call is sent every frame in full (host duplication);
+    // the STFT calls send frame 0 in full and then HOP new samples per frame.
+    const int STFT_FRAMES = 4;
+    const int HOP         = FFT_SIZE / 4;   // 75 % overlap
+    const int SIG_LEN     = FFT_SIZE + (STFT_FRAMES - 1) * HOP;
+    static fixed_t sig_re[SIG_LEN];
+    static fixed_t sig_im[SIG_LEN];
+    static axis_t  stft_ref[STFT_FRAMES][FFT_BEATS];
+    for (int n = 0; n < SIG_LEN; n++) {
+        sig_re[n] = (fixed_t)(0.5 * cos(2.0 * M_PI * 3.3 * n / FFT_SIZE));
+        sig_im[n] = (fixed_t)(0.25 * sin(2.0 * M_PI * 7.7 * n / FFT_SIZE));
+    }
+
+    // Reference: full frames, then FFT_FRAME_LATENCY frames past the signal
+    for (int f = 0; f < STFT_FRAMES + FFT_FRAME_LATENCY; f++) {
+        send_samples(in_stream, sig_re, sig_im, SIG_LEN, f * HOP, FFT_SIZE);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, 0, STFT_FRAMES + FFT_FRAME_LATENCY);
+    // Overlapped: frame 0 in full, then HOP new samples per frame
+    send_samples(in_stream, sig_re, sig_im, SIG_LEN, 0, FFT_SIZE);
+    run_fft(in_stream, out_stream, FFT_SIZE, 0);
+    for (int f = 1; f < STFT_FRAMES + FFT_FRAME_LATENCY; f++) {
+        send_samples(in_stream, sig_re, sig_im, SIG_LEN, FFT_SIZE + (f - 1) * HOP, HOP);
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, 0, STFT_FRAMES - 1 + FFT_FRAME_LATENCY, HOP);
+
+    // Output: in-flight frames, reference, its flush frames, overlapped frames
+    for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+        while (!out_stream.read().last) {}
+    }
+    for (int f = 0; f < STFT_FRAMES; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            stft_ref[f][b] = out_stream.read();
+        }
+    }
+    for (int i = 0; i < FFT_FRAME_LATENCY * FFT_BEATS; i++) {
+        out_stream.read();
+    }
+    for (int f = 0; f < STFT_FRAMES; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t result = out_stream.read();
+            if (result.data != stft_ref[f][b].data || result.user != stft_ref[f][b].user ||
+                result.last != stft_ref[f][b].last) {
+                printf("ERROR: STFT frame %d beat %d differs from the full frame\n", f, b);
+                stft_error = 1;
+            }
+        }
+    }
+    printf("STFT overlap:                %s\n", stft_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Spectral Averaging: one mean power spectrum per AVG_K frames
+     * ================================================================ */
+    int avg_error = 0;
+#if FFT_AVG
+    // Frame f is the dual-tone input scaled by AVG_AMP[f], so every bin's
+    // power scales by AVG_AMP[f]^2: block mean = 0.46875 * |X|^2, and the
+    // exponential average of the first two frames = 0.625 * |X|^2.
+    const int    AVG_K = 4;
+    const double AVG_AMP[AVG_K] = {1.0, 0.5, 0.75, 0.25};
+    for (int pass = 0; pass < 2; pass++) {
+        const fft_ctrl_t ctrl   = FFT_CTRL_FMT_POWER | (pass ? FFT_CTRL_AVG_EXP : 0);
+        const int        frames = pass ? 2 : AVG_K;
+        const float      gain   = pass ? 0.625f : 0.46875f;
+        for (int f = 0; f < frames; f++) {
+            for (int n = 0; n < FFT_SIZE; n++) {
+                axis_t beat;
+                pack_lane(beat.data, 0, (fixed_t)(in_real[n].to_double() * AVG_AMP[f]),
+                                        (fixed_t)(in_imag[n].to_double() * AVG_AMP[f]));
+                beat.keep = -1;
+                beat.strb = -1;
+                beat.last = (n == FFT_SIZE - 1) ? 1 : 0;
+                in_stream.write(beat);
+            }
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, ctrl, frames, 0, frames);
+        for (int b = 0; b < FFT_SIZE / 2; b++) {
+            axis_t result = out_stream.read();
+            if (result.last != ((b == FFT_SIZE / 2 - 1) ? 1 : 0)) {
+                printf("ERROR: averaged spectrum TLAST wrong at beat %d\n", b);
+                avg_error = 1;
+            }
+            float got[2];
+            unpack_scalars(result.data, 0, got[0], got[1]);
+            for (int h = 0; h < 2; h++) {
+                int   k   = 2 * b + h;
+                float im  = (FFT_REAL && k == 0) ? 0.0f : imag_out[k];   // DC without Nyquist
+                float pow_ = gain * (real_out[k] * real_out[k] + im * im);
+                if (fabsf(got[h] - pow_) > 1e-3f * max_mag * max_mag) {
+                    printf("ERROR: averaged power pass %d bin %d = %.4f, expected %.4f\n", pass, k, got[h], pow_);
+                    avg_error = 1;
+                }
+            }
+        }
+        if (!out_stream.empty()) {
+            printf("ERROR: averaging pass %d emitted more than one spectrum\n", pass);
+            avg_error = 1;
+        }
+    }
+    printf("Spectral averaging:          %s\n", avg_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Multi-Channel: frames of several channels through one engine
+     * ================================================================ */
+    int chan_error = 0;
+#if FFT_CHANNELS > 1
+    // Channel c carries the dual-tone input scaled by 1 / (c + 1)
+    const int CH_SEQ[3] = {1, 0, FFT_CHANNELS - 1};
+    for (int f = 0; f < 3 + FFT_FRAME_LATENCY; f++) {
+        const int    c    = (f < 3) ? CH_SEQ[f] : 0;
+        const double gain = (f < 3) ? 1.0 / (c + 1) : 0.0;
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t beat;
+            for (int l = 0; l < FFT_SSR; l++) {
+                int n = b * FFT_SSR + l;
+                pack_lane(beat.data, l, (fixed_t)(in_real[n].to_double() * gain),
+                                        (fixed_t)(in_imag[n].to_double() * gain));
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.id   = c;
+            beat.dest = 0;
+            beat.last = (b == FFT_BEATS - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, 0, 3 + FFT_FRAME_LATENCY);
+    for (int f = 0; f < FFT_FRAME_LATENCY; f++) {
+        while (!out_stream.read().last) {}
+    }
+    for (int f = 0; f < 3; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            axis_t result = out_stream.read();
+            if ((int)result.id != CH_SEQ[f] || (int)result.dest != CH_SEQ[f]) {
+                printf("ERROR: frame %d tagged TID %d / TDEST %d, expected channel %d\n",
+                       f, (int)result.id, (int)result.dest, CH_SEQ[f]);
+                chan_error = 1;
+            }
+            float scale = 1.0f;
+#if FFT_BFP
+            scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+            for (int l = 0; l < FFT_SSR; l++) {
+                int k = output_bin(b * FFT_SSR + l);
+                fixed_t r, im;
+                unpack_lane(result.data, l, r, im);
+                float g = 1.0f / (CH_SEQ[f] + 1);
+                if (fabsf((float)r * scale - g * real_out[k]) > 0.01f || fabsf((float)im * scale - g * imag_out[k]) > 0.01f) {
+                    printf("ERROR: channel %d bin %d mismatch\n", CH_SEQ[f], k);
+                    chan_error = 1;
+                }
+            }
+        }
+    }
+
+#if FFT_STFT
+    // Per-channel history: channel A gets the input frame and channel B
+    // zeros, then each gets a hop of HOP_C new samples. The dual tone is
+    // N-periodic, so A's second frame is the input rotated by HOP_C (same
+    // magnitudes) and B's stays zero.
+    const int HOP_C = FFT_SIZE / 4;
+    const int CH_A = 0, CH_B = FFT_CHANNELS - 1;
+    for (int t = 0; t < 4; t++) {
+        const int c     = (t & 1) ? CH_B : CH_A;
+        const int count = (t < 2) ? FFT_SIZE : HOP_C;
+        for (int n = 0; n < count; n++) {
+            axis_t beat;
+            pack_lane(beat.data, 0, (t & 1) ? (fixed_t)0.0 : in_real[n], (t & 1) ? (fixed_t)0.0 : in_imag[n]);
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.id   = c;
+            beat.dest = 0;
+            beat.last = (n == count - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, 0, 1, (t < 2) ? 0 : HOP_C);
+    }
+    for (int t = 0; t < 4; t++) {
+        for (int k = 0; k < FFT_SIZE; k++) {
+            axis_t result = out_stream.read();
+            fixed_t r, im;
+            unpack_lane(result.data, 0, r, im);
+            float scale = 1.0f;
+#if FFT_BFP
+            scale = ldexpf(1.0f, (int)(ap_int<FFT_TUSER_W>)result.user);
+#endif
+            float mag    = sqrtf((float)r * (float)r + (float)im * (float)im) * scale;
+            float expect = (t & 1) ? 0.0f : magnitude[k];
+            if (t >= 2 && fabsf(mag - expect) > 0.01f * max_mag) {
+                printf("ERROR: STFT channel %d bin %d magnitude %.4f, expected %.4f\n",
+                       (int)result.id, k, mag, expect);
+                chan_error = 1;
+            }
+        }
+    }
+#endif
+
+#if FFT_AVG
+    // Per-channel averaging: A, B, A, B with K = 2 gives one mean per channel
+    const int CH_AVG[2] = {0, FFT_CHANNELS - 1};
+    for (int f = 0; f < 4; f++) {
+        const double gain = (f & 1) ? 0.5 : 1.0;
+        for (int n = 0; n < FFT_SIZE; n++) {
+            axis_t beat;
+            pack_lane(beat.data, 0, (fixed_t)(in_real[n].to_double() * gain),
+                                    (fixed_t)(in_imag[n].to_double() * gain));
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.id   = CH_AVG[f & 1];
+            beat.dest = 0;
+            beat.last = (n == FFT_SIZE - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+    }
+    run_fft(in_stream, out_stream, FFT_SIZE, FFT_CTRL_FMT_POWER, 4, 0, 2);
+    for (int c = 0; c < 2; c++) {
+        const float gain = c ? 0.25f : 1.0f;
+        for (int b = 0; b < FFT_SIZE / 2; b++) {
+            axis_t result = out_stream.read();
+            if ((int)result.id != CH_AVG[c]) {
+                printf("ERROR: averaged spectrum %d tagged channel %d\n", c, (int)result.id);
+                chan_error = 1;
+            }
+            float got[2];
+            unpack_scalars(result.data, 0, got[0], got[1]);
+            for (int h = 0; h < 2; h++) {
+                int   k    = 2 * b + h;
+                float im   = (FFT_REAL && k == 0) ? 0.0f : imag_out[k];
+                float pow_ = gain * (real_out[k] * real_out[k] + im * im);
+                if (fabsf(got[h] - pow_) > 1e-3f * max_mag * max_mag) {
+                    printf("ERROR: channel %d averaged bin %d = %.4f, expected %.4f\n", CH_AVG[c], k, got[h], pow_);
+                    chan_error = 1;
+                }
+            }
+        }
+    }
+#endif
+    printf("Multi-channel:               %s\n", chan_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Performance Counters: one clean frame, then an overloaded one
+     * ================================================================ */
+    int perf_error = 0;
+#if FFT_PERF
+    // A constant frame at half full scale wraps in the first butterfly
+    // stage (PERF_DC + PERF_DC) unless BFP rescales it.
+    const double PERF_DC = 16384.0;
+    // Butterfly loop iterations of one full-length frame
+#if FFT_ENGINE == FFT_ENGINE_STAGED
+    const unsigned PERF_BFLY = FFT_SIZE / 2;
+#elif FFT_RADIX == 4
+    const unsigned PERF_BFLY = (LOG2_FFT_SIZE + 1) / 2 * (FFT_SIZE / 4);
+#else
+    const unsigned PERF_BFLY = LOG2_FFT_SIZE * (FFT_SIZE / 2);
+#endif
+#if FFT_INPLACE
+    const unsigned PERF_FRAME = FFT_SIZE + PERF_BFLY + FFT_SIZE;
+#else
+    const unsigned PERF_FRAME = (PERF_BFLY > FFT_SIZE) ? PERF_BFLY : FFT_SIZE;
+#endif
+    for (int pass = 0; pass < 2; pass++) {
+        for (int n = 0; n < FFT_SIZE; n++) {
+            axis_t beat;
+            if (pass) {
+                pack_lane(beat.data, 0, (fixed_t)PERF_DC, (fixed_t)0.0);
+            } else {
+                pack_lane(beat.data, 0, in_real[n], in_imag[n]);
+            }
+            beat.keep = -1;
+            beat.strb = -1;
+            beat.last = (n == FFT_SIZE - 1) ? 1 : 0;
+            in_stream.write(beat);
+        }
+        run_fft(in_stream, out_stream, FFT_SIZE, pass ? 0 : FFT_CTRL_PERF_CLEAR);
+        for (int n = 0; n < FFT_SIZE; n++) {
+            out_stream.read();
+        }
+        if (perf_regs[FFT_PERF_FRAMES] != (unsigned)(pass + 1) ||
+            perf_regs[FFT_PERF_CYCLES] != PERF_FRAME ||
+            perf_regs[FFT_PERF_IN_STALL] != 0 || perf_regs[FFT_PERF_OUT_STALL] != 0) {
+            printf("ERROR: perf pass %d: frames %u cycles %u stalls %u / %u\n", pass,
+                   (unsigned)perf_regs[FFT_PERF_FRAMES], (unsigned)perf_regs[FFT_PERF_CYCLES],
+                   (unsigned)perf_regs[FFT_PERF_IN_STALL], (unsigned)perf_regs[FFT_PERF_OUT_STALL]);
+            perf_error = 1;
+        }
+        if (perf_regs[FFT_PERF_IN_CYCLES] != FFT_SIZE || perf_regs[FFT_PERF_BFLY_CYCLES] != PERF_BFLY ||
+            perf_regs[FFT_PERF_OUT_CYCLES] != FFT_SIZE) {
+            printf("ERROR: perf pass %d: process cycles %u / %u / %u, expected %u / %u / %u\n", pass,
+                   (unsigned)perf_regs[FFT_PERF_IN_CYCLES], (unsigned)perf_regs[FFT_PERF_BFLY_CYCLES],
+                   (unsigned)perf_regs[FFT_PERF_OUT_CYCLES], FFT_SIZE, PERF_BFLY, FFT_SIZE);
+            perf_error = 1;
+        }
+        bool expect_ovf = pass && !FFT_BFP;
+        if ((perf_regs[FFT_PERF_OVERFLOW] != 0) != expect_ovf) {
+            printf("ERROR: perf pass %d: overflow count %u\n", pass,
+                   (unsigned)perf_regs[FFT_PERF_OVERFLOW]);
+            perf_error = 1;
+        }
+    }
+    printf("Performance counters:        %s\n", perf_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Memory-Mapped Top: a batch from and to DDR buffers
+     * ================================================================ */
+    int mm_error = 0;
+#if FFT_MM
+    // Frame f is the dual-tone input scaled by MM_AMP[f]; the SDF engine's
+    // first FFT_FRAME_LATENCY outputs are the zero state of fft_mm's engine.
+    const int    MM_FRAMES = 3;
+    const int    MM_TOTAL  = MM_FRAMES + FFT_FRAME_LATENCY;
+    const double MM_AMP[MM_FRAMES] = {1.0, -0.5, 0.25};
+    static beat_t mm_src[MM_TOTAL * FFT_BEATS], mm_dst[MM_TOTAL * FFT_BEATS];
+    for (int f = 0; f < MM_TOTAL; f++) {
+        double amp = (f < MM_FRAMES) ? MM_AMP[f] : 0.0;
+        for (int b = 0; b < FFT_BEATS; b++) {
+            for (int l = 0; l < FFT_SSR; l++) {
+                int n = b * FFT_SSR + l;
+                pack_lane(mm_src[f * FFT_BEATS + b], l, (fixed_t)(in_real[n].to_double() * amp),
+                                                        (fixed_t)(in_imag[n].to_double() * amp));
+            }
+        }
+    }
+    fft_words_t mm_words = 0;
+    fft_mm(mm_src, mm_dst, FFT_SIZE, 0, MM_TOTAL, mm_words
+           TB_HOP_ARG(0) TB_AVG_ARG(0) TB_PEAK_ARG(0) TB_PERF_ARG TB_FILT_ARG TB_PFB_ARG TB_WIN_ARG);
+    if (mm_words != (unsigned)(MM_TOTAL * FFT_BEATS)) {
+        printf("ERROR: fft_mm wrote %u words, expected %d\n", (unsigned)mm_words, MM_TOTAL * FFT_BEATS);
+        mm_error = 1;
+    }
+    for (int f = 0; f < MM_FRAMES; f++) {
+        for (int b = 0; b < FFT_BEATS; b++) {
+            for (int l = 0; l < FFT_SSR; l++) {
+                int k = output_bin(b * FFT_SSR + l);
+                fixed_t r, im;
+                unpack_lane(mm_dst[(f + FFT_FRAME_LATENCY) * FFT_BEATS + b], l, r, im);
+                float er = (float)r - MM_AMP[f] * real_out[k];
+                float ei = (float)im - MM_AMP[f] * imag_out[k];
+                if (fabsf(er) > 0.01f * max_mag || fabsf(ei) > 0.01f * max_mag) {
+                    printf("ERROR: fft_mm frame %d bin %d = (%.4f, %.4f), expected (%.4f, %.4f)\n", f, k,
+                           (float)r, (float)im, MM_AMP[f] * real_out[k], MM_AMP[f] * imag_out[k]);
+                    mm_error = 1;
+                }
+            }
+        }
+    }
+#if FFT_AVG
+    // Averaging batches that end inside a block: 2 frames per channel and
+    // one more for channel 0 (ending on a null TLAST beat), then a single
+    // frame that completes channel 0's block in the next call
+    const int MM_AVG_K = 2;
+    static_assert((MM_AVG_K * FFT_CHANNELS + 1) * FFT_BEATS <= FFT_MM_DEPTH,
+                  "averaging batch exceeds the fft_mm port depth");
+    static beat_t mm_avg_src[(MM_AVG_K * FFT_CHANNELS + 1) * FFT_BEATS];
+    static beat_t mm_avg_dst[(MM_AVG_K * FFT_CHANNELS + 1) * FFT_BEATS];
+    for (int f = 0; f < MM_AVG_K * FFT_CHANNELS + 1; f++) {
+        for (int n = 0; n < FFT_SIZE; n++) {
+            pack_lane(mm_avg_src[f * FFT_BEATS + n], 0, in_real[n], in_imag[n]);
+        }
+    }
+    for (int call = 0; call < 2; call++) {
+        const int frames = call ? 1 : MM_AVG_K * FFT_CHANNELS + 1;
+        const int spectra = call ? 1 : FFT_CHANNELS;
+        fft_words_t avg_words = 0;
+        fft_mm(mm_avg_src, mm_avg_dst, FFT_SIZE, FFT_CTRL_FMT_POWER, frames, avg_words
+               TB_HOP_ARG(0) TB_AVG_ARG(MM_AVG_K) TB_PEAK_ARG(0) TB_PERF_ARG TB_FILT_ARG TB_PFB_ARG TB_WIN_ARG);
+        if (avg_words != (unsigned)(spectra * FFT_BEATS / 2)) {
+            printf("ERROR: averaging fft_mm call %d wrote %u words, expected %d\n", call,
+                   (unsigned)avg_words, spectra * FFT_BEATS / 2);
+            mm_error = 1;
+            continue;
+        }
+        for (int w = 0; w < spectra * FFT_BEATS / 2; w++) {
+            float got[2];
+            unpack_scalars(mm_avg_dst[w], 0, got[0], got[1]);
+            for (int h = 0; h < 2; h++) {
+                int   k    = (2 * w + h) % FFT_SIZE;
+                float im   = (FFT_REAL && k == 0) ? 0.0f : imag_out[k];
+                float pow_ = real_out[k] * real_out[k] + im * im;
+                if (fabsf(got[h] - pow_) > 1e-3f * max_mag * max_mag) {
+                    printf("ERROR: averaging fft_mm call %d bin %d = %.4f, expected %.4f\n", call, k, got[h], pow_);
+                    mm_error = 1;
+                }
+            }
+        }
+    }
+#endif
+    printf("Memory-mapped top:           %s\n", mm_error ? "FAIL" : "PASS");
+#endif
+
+    /* ================================================================
+     *  Polyphase Filter Bank: loaded prototype against a direct sum
+     * ================================================================ */
+    int pfb_error = 0;
+#if FFT_PFB_TAPS
+    pfb_error = pfb_check(in_stream, out_stream);
+#endif
+
+    /* ================================================================
+     *  Peak Detection: top-K records of a three-tone frame
+     * ================================================================ */
+    int peak_error = 0;
+#if FFT_PEAKS
+    peak_error = peak_check(in_stream, out_stream);
+#endif
+
+    /* ================================================================
+     *  Accuracy Benchmark: randomized frames against a double reference
+     * ================================================================ */
+    int bench_error = accuracy_bench(in_stream, out_stream);
+
+    /* ================================================================
+     *  Host Frame Sizing: fft_frame_words against the IP's reads
+     * ================================================================ */
+    int sizing_error = host_sizing_check(in_stream, out_stream);
+
     /* ================================================================
      *  Report Results
      * ================================================================ */
     printf("\n=== Verification Results ===\n");
     printf("Peak at bin %d (f1):         %s (mag=%.4f)\n", TONE1, peak_f1 ? "FOUND" : "MISSING", magnitude[TONE1]);
     printf("Peak at bin %d (f2):         %s (mag=%.4f)\n", TONE2, peak_f2 ? "FOUND" : "MISSING", magnitude[TONE2]);
+#if !FFT_REAL
     printf("Peak at bin %d (f1 mirror):  %s (mag=%.4f)\n", FFT_SIZE - TONE1, peak_f1_mirror ? "FOUND" : "MISSING", magnitude[FFT_SIZE - TONE1]);
     printf("Peak at bin %d (f2 mirror):  %s (mag=%.4f)\n", FFT_SIZE - TONE2, peak_f2_mirror ? "FOUND" : "MISSING", magnitude[FFT_SIZE - TONE2]);
+#endif
     printf("TLAST check:                 %s\n", tlast_error ? "FAIL" : "PASS");
     printf("Unexpected peaks:            %d\n", unexpected_peaks);
+#if !FFT_REAL
+    printf("Inverse round trip:          %s (max err=%.4f)\n", inverse_error ? "FAIL" : "PASS", max_inv_err);
+#endif
 
     // Final pass/fail
     int result = 0;
@@ -153,6 +1602,66 @@ int main() {
         printf("\nFAIL: TLAST signal error.\n");
         result = 1;
     }
+    if (short_error) {
+        printf("\nFAIL: Runtime length frame error.\n");
+        result = 1;
+    }
+    if (inverse_error) {
+        printf("\nFAIL: Inverse transform error.\n");
+        result = 1;
+    }
+    if (format_error) {
+        printf("\nFAIL: Output format error.\n");
+        result = 1;
+    }
+    if (window_error) {
+        printf("\nFAIL: Input window error.\n");
+        result = 1;
+    }
+    if (bench_error) {
+        printf("\nFAIL: Accuracy benchmark error.\n");
+        result = 1;
+    }
+    if (sizing_error) {
+        printf("\nFAIL: Host frame sizing error.\n");
+        result = 1;
+    }
+    if (pfb_error) {
+        printf("\nFAIL: PFB channelizer error.\n");
+        result = 1;
+    }
+    if (peak_error) {
+        printf("\nFAIL: Peak record error.\n");
+        result = 1;
+    }
+    if (mm_error) {
+        printf("\nFAIL: Memory-mapped top error.\n");
+        result = 1;
+    }
+    if (perf_error) {
+        printf("\nFAIL: Performance counter error.\n");
+        result = 1;
+    }
+    if (chan_error) {
+        printf("\nFAIL: Multi-channel error.\n");
+        result = 1;
+    }
+    if (avg_error) {
+        printf("\nFAIL: Spectral averaging error.\n");
+        result = 1;
+    }
+    if (stft_error) {
+        printf("\nFAIL: STFT overlap error.\n");
+        result = 1;
+    }
+    if (batch_error) {
+        printf("\nFAIL: Batch mode error.\n");
+        result = 1;
+    }
+    if (order_error) {
+        printf("\nFAIL: Bit-reversed order error.\n");
+        result = 1;
+    }
     if (result == 0) {
         printf("\n=== TEST PASSED ===\n");
     } else {
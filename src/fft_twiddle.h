@@ -0,0 +1,233 @@
+/**
+ * @file fft_twiddle.h
+ * @brief Compile-time generated twiddle factor ROMs
+ *
+ * W_M^k = cos(-2*pi*k/M) + j*sin(-2*pi*k/M), k = 0..M/2-1, is evaluated by
+ * constexpr functions and only quantised to TwiddleT in the ROM
+ * initialiser, so every transform (or stage) size gets an exactly sized
+ * table with no hand-edited literals. With FFT_TWIDDLE_OCTANT only one
+ * octant is stored and the rest is rebuilt by index folding.
+ */
+
+#ifndef FFT_TWIDDLE_H
+#define FFT_TWIDDLE_H
+
+#include <ap_int.h>
+#include <utility>
+
+#include "fft.h"
+
+/* ================================================================
+ *  Compile-Time Math
+ * ================================================================ */
+
+/**
+ * @brief log2 of a power of two, usable in template arguments
+ */
+constexpr int fft_log2(int n) {
+    return (n <= 1) ? 0 : 1 + fft_log2(n >> 1);
+}
+
+constexpr double FFT_CE_PI = 3.14159265358979323846;
+
+/**
+ * @brief Taylor series for sin(x), double accurate on |x| <= pi/4
+ */
+constexpr double fft_ce_sin_poly(double x) {
+    double term = x;
+    double sum  = x;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum  += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Taylor series for cos(x), double accurate on |x| <= pi/4
+ */
+constexpr double fft_ce_cos_poly(double x) {
+    double term = 1.0;
+    double sum  = 1.0;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i - 1) * (2 * i));
+        sum  += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief cos or sin of 2*pi*k/n with exact octant folding
+ *
+ * The angle is reduced to one octant with integer arithmetic, so values
+ * such as cos(pi/2) come out exactly 0 and the table is exactly symmetric.
+ */
+constexpr double fft_ce_trig_2pi(long long k, long long n, bool want_sin) {
+    k = ((k % n) + n) % n;
+    long long oct = (8 * k) / n;          // octant 0..7
+    long long rem = 8 * k - oct * n;      // position within octant, 0..n-1
+    double phi  = (FFT_CE_PI / 4) * (double)rem / (double)n;        // from octant start
+    double phic = (FFT_CE_PI / 4) * (double)(n - rem) / (double)n;  // to octant end
+    double s  = fft_ce_sin_poly(phi),  c  = fft_ce_cos_poly(phi);
+    double sc = fft_ce_sin_poly(phic), cc = fft_ce_cos_poly(phic);
+    switch (oct) {
+    case 0:  return want_sin ?  s  :  c;
+    case 1:  return want_sin ?  cc :  sc;
+    case 2:  return want_sin ?  c  : -s;
+    case 3:  return want_sin ?  sc : -cc;
+    case 4:  return want_sin ? -s  : -c;
+    case 5:  return want_sin ? -cc : -sc;
+    case 6:  return want_sin ? -c  :  s;
+    default: return want_sin ? -sc :  cc;
+    }
+}
+
+/* ================================================================
+ *  Twiddle ROM
+ * ================================================================ */
+
+/**
+ * @brief ROM of the first M/2 twiddles W_M^k, quantised to TwiddleT
+ *
+ * Each (M, TwiddleT) pair gets its own static table, so an engine only
+ * carries the sizes it actually addresses. sum / dif hold re + im and
+ * im - re for the three-multiply complex product; like any unread ROM
+ * they are only built when that form is selected.
+ */
+template <int M, typename TwiddleT, typename Seq = std::make_integer_sequence<int, M / 2> >
+struct twiddle_rom;
+
+template <int M, typename TwiddleT, int... K>
+struct twiddle_rom<M, TwiddleT, std::integer_sequence<int, K...> > {
+    static const TwiddleT re[M / 2];
+    static const TwiddleT im[M / 2];
+    static const TwiddleT sum[M / 2];
+    static const TwiddleT dif[M / 2];
+};
+
+template <int M, typename TwiddleT, int... K>
+const TwiddleT twiddle_rom<M, TwiddleT, std::integer_sequence<int, K...> >::re[M / 2] = {
+    TwiddleT(fft_ce_trig_2pi(K, M, false))...
+};
+
+template <int M, typename TwiddleT, int... K>
+const TwiddleT twiddle_rom<M, TwiddleT, std::integer_sequence<int, K...> >::im[M / 2] = {
+    TwiddleT(-fft_ce_trig_2pi(K, M, true))...
+};
+
+template <int M, typename TwiddleT, int... K>
+const TwiddleT twiddle_rom<M, TwiddleT, std::integer_sequence<int, K...> >::sum[M / 2] = {
+    TwiddleT(fft_ce_trig_2pi(K, M, false) - fft_ce_trig_2pi(K, M, true))...
+};
+
+template <int M, typename TwiddleT, int... K>
+const TwiddleT twiddle_rom<M, TwiddleT, std::integer_sequence<int, K...> >::dif[M / 2] = {
+    TwiddleT(-fft_ce_trig_2pi(K, M, true) - fft_ce_trig_2pi(K, M, false))...
+};
+
+/**
+ * @brief One twiddle factor with its precomputed sum and difference
+ */
+template <typename TwiddleT>
+struct twiddle_pt {
+    TwiddleT re, im;
+    TwiddleT sum;   // re + im
+    TwiddleT dif;   // im - re
+};
+
+/**
+ * @brief ROM of cos / sin(2*pi*i/M) for i = 0 .. M/8 (one octant)
+ */
+template <int M, typename TwiddleT, typename Seq = std::make_integer_sequence<int, M / 8 + 1> >
+struct twiddle_oct_rom;
+
+template <int M, typename TwiddleT, int... I>
+struct twiddle_oct_rom<M, TwiddleT, std::integer_sequence<int, I...> > {
+    static const TwiddleT cos_t[M / 8 + 1];
+    static const TwiddleT sin_t[M / 8 + 1];
+};
+
+template <int M, typename TwiddleT, int... I>
+const TwiddleT twiddle_oct_rom<M, TwiddleT, std::integer_sequence<int, I...> >::cos_t[M / 8 + 1] = {
+    TwiddleT(fft_ce_trig_2pi(I, M, false))...
+};
+
+template <int M, typename TwiddleT, int... I>
+const TwiddleT twiddle_oct_rom<M, TwiddleT, std::integer_sequence<int, I...> >::sin_t[M / 8 + 1] = {
+    TwiddleT(fft_ce_trig_2pi(I, M, true))...
+};
+
+/**
+ * @brief W_M^k lookup, from the half-period ROM or the octant ROM
+ *
+ * OCTANT rebuilds theta = 2*pi*k/M from the octant ROM: octant o = k / (M/8),
+ * odd octants read at M/8 - r, the cos/sin pair swaps in octants 1 and 2
+ * and cos changes sign in octants 2 and 3 (k < M/2). The ROM drops from M
+ * to M/4 + 2 entries; sum / dif become adders.
+ */
+template <int M, typename TwiddleT, bool OCTANT = (FFT_TWIDDLE_OCTANT && M >= 16)>
+struct twiddle_lookup {
+    static twiddle_pt<TwiddleT> at(int k) {
+        #pragma HLS INLINE
+        twiddle_pt<TwiddleT> w;
+        w.re  = twiddle_rom<M, TwiddleT>::re[k];
+        w.im  = twiddle_rom<M, TwiddleT>::im[k];
+        w.sum = twiddle_rom<M, TwiddleT>::sum[k];
+        w.dif = twiddle_rom<M, TwiddleT>::dif[k];
+        return w;
+    }
+};
+
+template <int M, typename TwiddleT>
+struct twiddle_lookup<M, TwiddleT, true> {
+    static twiddle_pt<TwiddleT> at(int k) {
+        #pragma HLS INLINE
+        const int LOG2_O = fft_log2(M) - 3;         // log2 of entries per octant
+        ap_uint<fft_log2(M) - 1> kk = k;
+        ap_uint<2>      oct = kk >> LOG2_O;
+        ap_uint<LOG2_O> r   = kk;                   // k mod M/8
+        ap_uint<LOG2_O + 1> u = oct[0] ? (ap_uint<LOG2_O + 1>)((M / 8) - r)
+                                       : (ap_uint<LOG2_O + 1>)r;
+
+        TwiddleT c = twiddle_oct_rom<M, TwiddleT>::cos_t[u];
+        TwiddleT s = twiddle_oct_rom<M, TwiddleT>::sin_t[u];
+        bool     swap = oct[0] ^ oct[1];
+        TwiddleT x = swap ? s : c;                  // |cos(theta)|
+        TwiddleT y = swap ? c : s;                  // sin(theta) >= 0 on [0, pi)
+
+        twiddle_pt<TwiddleT> w;
+        w.re  = oct[1] ? (TwiddleT)-x : x;
+        w.im  = -y;
+        w.sum = w.re + w.im;
+        w.dif = w.im - w.re;
+        return w;
+    }
+};
+
+/**
+ * @brief Look up W_M^k for 0 <= k < M/2
+ */
+template <int M, typename TwiddleT>
+static twiddle_pt<TwiddleT> twiddle_at(int k) {
+    #pragma HLS INLINE
+    return twiddle_lookup<M, TwiddleT>::at(k);
+}
+
+/**
+ * @brief Look up W_M^e for 0 <= e < M from the half-period ROM
+ */
+template <int M, typename TwiddleT>
+static twiddle_pt<TwiddleT> twiddle_full(ap_uint<fft_log2(M)> e) {
+    #pragma HLS INLINE
+    ap_uint<fft_log2(M) - 1> idx = e & (M / 2 - 1);
+    twiddle_pt<TwiddleT> w = twiddle_at<M, TwiddleT>(idx);
+    if (e[fft_log2(M) - 1]) {   // W^(e + M/2) = -W^e
+        w.re  = -w.re;
+        w.im  = -w.im;
+        w.sum = -w.sum;
+        w.dif = -w.dif;
+    }
+    return w;
+}
+
+#endif // FFT_TWIDDLE_H
@@ -0,0 +1,88 @@
+/**
+ * @file fft_window.h
+ * @brief Input window coefficients: compile-time ROMs or AXI-Lite RAM
+ *
+ * Built-in windows are the periodic (DFT-even) forms over FFT_WINDOW_LEN
+ * points, evaluated by the constexpr trig of fft_twiddle.h and quantised
+ * to window_t in the ROM initialiser. A shorter active length L reads
+ * every (FFT_WINDOW_LEN / L)-th entry, which is exactly the L-point window.
+ * The RAM holds whatever the host writes, two coefficients per word.
+ */
+
+#ifndef FFT_WINDOW_H
+#define FFT_WINDOW_H
+
+#include <ap_int.h>
+#include <utility>
+
+#include "fft.h"
+#include "fft_twiddle.h"
+
+/* ================================================================
+ *  Built-In Windows
+ * ================================================================ */
+
+/**
+ * @brief w[n] of a periodic M-point window of the given FFT_WINDOW_* kind
+ *
+ * Cosine-sum form a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x), x = 2*pi*n/M.
+ */
+constexpr double fft_ce_window(int kind, long long n, long long m) {
+    return (kind == FFT_WINDOW_HANN)
+               ? 0.5 - 0.5 * fft_ce_trig_2pi(n, m, false)
+         : (kind == FFT_WINDOW_HAMMING)
+               ? 0.54 - 0.46 * fft_ce_trig_2pi(n, m, false)
+         : (kind == FFT_WINDOW_BLACKMAN_HARRIS)
+               ? 0.35875 - 0.48829 * fft_ce_trig_2pi(n, m, false)
+                         + 0.14128 * fft_ce_trig_2pi(2 * n, m, false)
+                         - 0.01168 * fft_ce_trig_2pi(3 * n, m, false)
+               : 1.0;
+}
+
+/**
+ * @brief ROM of the M-point window of kind KIND, quantised to window_t
+ */
+template <int M, int KIND, typename Seq = std::make_integer_sequence<int, M> >
+struct window_rom;
+
+template <int M, int KIND, int... I>
+struct window_rom<M, KIND, std::integer_sequence<int, I...> > {
+    static const window_t w[M];
+};
+
+template <int M, int KIND, int... I>
+const window_t window_rom<M, KIND, std::integer_sequence<int, I...> >::w[M] = {
+    window_t(fft_ce_window(KIND, I, M))...
+};
+
+/* ================================================================
+ *  Coefficient Lookup
+ * ================================================================ */
+
+/**
+ * @brief Coefficients of window samples 2m and 2m + 1 for a 2^log2_wlen-point window
+ *
+ * One RAM word or two ROM reads, so a real-mode word or a 2-lane beat is
+ * weighted in a single clock.
+ */
+template <int M>
+static void window_pair(ap_uint<fft_log2(M)> m, ap_uint<5> log2_wlen,
+#if FFT_WINDOW == FFT_WINDOW_RAM
+                        const window_word_t window_coef[M / 2],
+#endif
+                        window_t &w0, window_t &w1) {
+    #pragma HLS INLINE
+#if FFT_WINDOW == FFT_WINDOW_RAM
+    (void)log2_wlen;
+    window_word_t word = window_coef[m];
+    w0.range() = word.range(15, 0);
+    w1.range() = word.range(31, 16);
+#else
+    ap_uint<fft_log2(M)> n0 = (ap_uint<fft_log2(M)>)(2 * m) << (int)(fft_log2(M) - log2_wlen);
+    ap_uint<fft_log2(M)> n1 = (ap_uint<fft_log2(M)>)(2 * m + 1) << (int)(fft_log2(M) - log2_wlen);
+    w0 = window_rom<M, FFT_WINDOW>::w[n0];
+    w1 = window_rom<M, FFT_WINDOW>::w[n1];
+#endif
+}
+
+#endif // FFT_WINDOW_H